@@ -0,0 +1,163 @@
+/*
+CLI command dispatch microbenchmark - a model of the cli.c lookup.
+
+cli.c isn't linked: its command table is fixed at compile time, while
+this benchmark needs tables of 10, 100 and 1000 commands. _find_linear
+and _find_phash copy the exact-name path of _find_command in cli.c (the
+first char pre-filter and strcmp without CLI_USE_PHASH, one slot and
+strcmp with it) and must be kept in step with it. Not modelled: the
+flash reads of CLI_READ_FLASH_WORD and the prefix match of
+_match_command, which runs only when no name matches exactly.
+
+Looks up every name of a synthetic command table with both lookups and
+reports the average cost per lookup at 10, 100 and 1000 commands.
+The table is built at startup with the same builder as cli_phashgen.
+Cycles are counted with the time-stamp counter on x86 only.
+*/
+
+#include "../cli_hash.h"
+#include "../tools/cli_phash_build.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#define MAX_COMMANDS 1000
+#define MAX_NAME_LEN 24
+#define LOOKUP_COUNT 2000000
+
+static char names[MAX_COMMANDS][MAX_NAME_LEN];
+static const char *name_ptrs[MAX_COMMANDS];
+static volatile size_t sink;
+
+/* Measurement helpers */
+
+typedef struct
+{
+    struct timespec time;
+    unsigned long long cycles;
+} Stamp_t;
+
+static Stamp_t _stamp(void)
+{
+    Stamp_t stamp;
+    clock_gettime(CLOCK_MONOTONIC, &stamp.time);
+#if HAVE_TSC
+    stamp.cycles = __rdtsc();
+#else
+    stamp.cycles = 0;
+#endif
+    return stamp;
+}
+
+static void _report(const char *name, size_t count, Stamp_t start,
+                    Stamp_t stop, size_t lookups)
+{
+    double ns = (stop.time.tv_sec - start.time.tv_sec) * 1e9 +
+                (stop.time.tv_nsec - start.time.tv_nsec);
+    printf("%-12s %4zu commands %8.2f ns/lookup", name, count, ns / lookups);
+#if HAVE_TSC
+    printf(" %8.2f cycles/lookup",
+           (double)(stop.cycles - start.cycles) / lookups);
+#endif
+    printf("\n");
+}
+
+/* Command table - names sharing a few prefixes, like the real ones */
+
+static void _make_names(size_t count)
+{
+    static const char *const prefixes[] = {
+        "get", "set", "diag", "show", "reset", "log", "cal", "test",
+    };
+    for (size_t i = 0; i < count; i++)
+    {
+        snprintf(names[i], MAX_NAME_LEN, "%s_%s%zu", prefixes[i % 8],
+                 (i & 1) ? "reg" : "sensor", i);
+        name_ptrs[i] = names[i];
+    }
+}
+
+/* Lookups - copies of _find_command in cli.c */
+
+static size_t _find_linear(const uint8_t *name, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // first symbol pre-filter
+        if (name[0] != (uint8_t)names[i][0])
+        {
+            continue;
+        }
+        if (strcmp((const char *)name, names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+static size_t _find_phash(const uint8_t *name, const CliPhash_t *table,
+                          size_t count)
+{
+    uint16_t slot = CliHash_Slot(name, table->seeds, table->bucket_count - 1,
+                                 table->slot_count - 1);
+    uint16_t index = table->slots[slot];
+    if (0 != index && strcmp((const char *)name, names[index - 1]) == 0)
+    {
+        return index - 1;
+    }
+    return count;
+}
+
+static void bench_dispatch(size_t count)
+{
+    CliPhash_t table;
+    Stamp_t start;
+    _make_names(count);
+    if (0 != CliPhash_Build(&table, name_ptrs, count))
+    {
+        printf("failed to build the table of %zu commands\n", count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i != _find_phash((const uint8_t *)names[i], &table, count))
+        {
+            printf("%s isn't found in the table\n", names[i]);
+        }
+    }
+
+    start = _stamp();
+    for (size_t n = 0; n < LOOKUP_COUNT; n++)
+    {
+        sink = _find_linear((const uint8_t *)names[n % count], count);
+    }
+    _report("linear scan", count, start, _stamp(), LOOKUP_COUNT);
+
+    start = _stamp();
+    for (size_t n = 0; n < LOOKUP_COUNT; n++)
+    {
+        sink = _find_phash((const uint8_t *)names[n % count], &table, count);
+    }
+    _report("perfect hash", count, start, _stamp(), LOOKUP_COUNT);
+
+    printf("%29s %u buckets, %u slots\n", "", (unsigned)table.bucket_count,
+           (unsigned)table.slot_count);
+    CliPhash_Free(&table);
+}
+
+int main(void)
+{
+    printf("model of the cli.c exact-name lookup (see the file header)\n");
+    bench_dispatch(10);
+    bench_dispatch(100);
+    bench_dispatch(1000);
+    return 0;
+}
@@ -0,0 +1,15 @@
+/*
+Configuration of bench_ucterm_single: the only instance
+with the output and exec hooks bound at compile time.
+*/
+
+#ifndef BENCH_HOOKS_H_
+#define BENCH_HOOKS_H_
+
+extern volatile uint8_t bench_sink;
+
+#define UCTERM_SINGLE_INSTANCE 1
+#define UCTERM_HOOK_PRINT_CHAR(c) (bench_sink = (c))
+#define UCTERM_HOOK_EXEC(argc, argv) (bench_sink = (argc))
+
+#endif // BENCH_HOOKS_H_
@@ -0,0 +1,148 @@
+/*
+UcTerm input processing microbenchmark.
+
+Feeds typical workloads to the engine and reports the average cost
+per input byte. Build the bench_ucterm and bench_ucterm_baseline targets
+(the latter has the end-of-line fast path disabled with
+UCTERM_FAST_APPEND=0) and compare their output. bench_ucterm_single
+is built with the single instance and compile-time hooks
+(see bench_hooks.h), its callbacks below are registered but unused.
+Cycles are counted with the time-stamp counter on x86 only.
+*/
+
+#include "../ucterm.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+
+#define LINE_COUNT 20000
+#define LINE_LEN   100
+
+static UcTerm_HandleTypeDef hucterm;
+volatile uint8_t bench_sink;
+
+/* Callbacks - emulate an output without the I/O cost */
+
+static void printChar(uint8_t c)
+{
+    bench_sink = c;
+}
+
+static void printStr(const uint8_t *s)
+{
+    while (*s != '\0')
+    {
+        bench_sink = *(s++);
+    }
+}
+
+static void execute(uint8_t argc, uint8_t *argv[])
+{
+    bench_sink = argc;
+}
+
+/* Measurement helpers */
+
+typedef struct
+{
+    struct timespec time;
+    unsigned long long cycles;
+} Stamp_t;
+
+static Stamp_t _stamp(void)
+{
+    Stamp_t stamp;
+    clock_gettime(CLOCK_MONOTONIC, &stamp.time);
+#if HAVE_TSC
+    stamp.cycles = __rdtsc();
+#else
+    stamp.cycles = 0;
+#endif
+    return stamp;
+}
+
+static void _report(const char *name, Stamp_t start, Stamp_t stop,
+                    size_t bytes)
+{
+    double ns = (stop.time.tv_sec - start.time.tv_sec) * 1e9 +
+                (stop.time.tv_nsec - start.time.tv_nsec);
+    printf("%-28s %8.2f ns/byte", name, ns / bytes);
+#if HAVE_TSC
+    printf(" %8.2f cycles/byte", (double)(stop.cycles - start.cycles) / bytes);
+#endif
+    printf("\n");
+}
+
+static void _init(void)
+{
+    UcTerm_Init(&hucterm);
+    UcTerm_RegisterPrintCharCallback(&hucterm, &printChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &printStr);
+    UcTerm_RegisterExecuteCallback(&hucterm, &execute);
+}
+
+/* Workloads */
+
+static void bench_typing(const uint8_t *line, size_t len)
+{
+    _init();
+    Stamp_t start = _stamp();
+    for (int n = 0; n < LINE_COUNT; n++)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            UcTerm_IngestChar(&hucterm, line[i]);
+        }
+    }
+    _report("typing (IngestChar)", start, _stamp(), LINE_COUNT * len);
+}
+
+static void bench_chunks(const uint8_t *line, size_t len)
+{
+    _init();
+    Stamp_t start = _stamp();
+    for (int n = 0; n < LINE_COUNT; n++)
+    {
+        UcTerm_IngestBuffer(&hucterm, line, len);
+    }
+    _report("chunks (IngestBuffer)", start, _stamp(), LINE_COUNT * len);
+}
+
+static void bench_edits(const uint8_t *line, size_t len)
+{
+    _init();
+    Stamp_t start = _stamp();
+    for (int n = 0; n < LINE_COUNT; n++)
+    {
+        UcTerm_IngestBuffer(&hucterm, line, len);
+    }
+    _report("chunks, mid-line edits", start, _stamp(), LINE_COUNT * len);
+}
+
+int main(void)
+{
+    static uint8_t line[LINE_LEN + 1];
+    static const uint8_t edits[] =
+        "set value 0123456789\x1B[D\x1B[D\x1B[D\x7F\x7FXY\x1B[4~ done\r";
+    for (size_t i = 0; i < LINE_LEN - 1; i++)
+    {
+        line[i] = 'a' + (i % 26);
+    }
+    line[LINE_LEN - 1] = '\r';
+
+    printf("UCTERM_FAST_APPEND=%d, UCTERM_SINGLE_INSTANCE=%d, "
+           "%d lines of %d bytes\n",
+           UCTERM_FAST_APPEND, UCTERM_SINGLE_INSTANCE, LINE_COUNT, LINE_LEN);
+    bench_typing(line, LINE_LEN);
+    bench_chunks(line, LINE_LEN);
+    bench_edits(edits, sizeof(edits) - 1);
+    return 0;
+}
@@ -3,155 +3,484 @@
 #include <stdint.h>
 #include <string.h>
 
-// Number of avaiable commands
-#define MAX_CLI_COMMANDS 2
-// TODO modify according to your needs
+// Define (i.e. -DCLI_CONFIG_FILE=\"my_cli_config.h\") to include a header
+// first: it may name another command list in CLI_COMMANDS_FILE (and declare
+// its handlers), or define CLI_DRIVER_DEFINED and the interface driver
+// functions below.
+#if defined(CLI_CONFIG_FILE)
+#include CLI_CONFIG_FILE
+#endif
+
+#ifndef CLI_COMMANDS_FILE
+#define CLI_COMMANDS_FILE "cli_commands.def"
+#endif
+
+// Define to look up the commands in the tables generated from
+// cli_commands.def by tools/cli_phashgen (see CMakeLists.txt):
+// the perfect hash table of the names and the names order,
+// otherwise the command table is scanned.
+#if defined(CLI_USE_PHASH)
+#include "cli_hash.h"
+#include "cli_commands_phash.h"
+#endif
 
-// CLI command handler function type
-typedef void (*CliCommandHandle_t)(uint8_t argc, const uint8_t *argv[]);
+// Define to collect the commands registered with CLI_COMMAND
+// in all the linked modules (see cli.h) along with cli_commands.def.
+// The table is known at link time only, so it's scanned.
+#if defined(CLI_USE_SECTION) && defined(CLI_USE_PHASH)
+#error "CLI_USE_SECTION and CLI_USE_PHASH are mutually exclusive"
+#endif
 
-// CLI command definition type
+// CLI command lookup result
 typedef struct
 {
-    const char *name;           // command name
-    CliCommandHandle_t handler; // function to execute
-    const char *help;           // short help string
-} CliCommand_t;
+    const CliCommand_t *command; // exact or unique prefix match, or NULL
+    uint16_t first;              // first candidate (in name order)
+    uint16_t count;              // number of candidates, 0 if unknown
+} CliMatch_t;
 
 /* Command handler fuction prototypes (internal) */
-static void cmd_help(uint8_t argc, const uint8_t *argv[]);
-static void cmd_uname(uint8_t argc, const uint8_t *argv[]);
-// TODO add yours
+static void cmd_help(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+static void cmd_uname(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+// TODO add yours, and the commands to cli_commands.def
+
+/* Argument completer fuction prototypes (internal) */
+static void complete_help(CliSession_t *session, UcTerm_Completion_t *completion);
 
 /* Command handler fuction prototypes (external) */
 // TODO add your definitions to cli.h and implement outside
 
-/* Ucterm callback fuction prototypes - interface-specific */
-static inline uint8_t _uart_get_char(void);            // TODO your implementation
-static inline void _uart_send_char(uint8_t c);         // TODO your implementation
-static inline void _uart_send_str(const uint8_t *str); // TODO your implementation
-static inline void _execute(uint8_t argc, uint8_t *argv[]);
+/* Interface driver fuction prototypes - interface-specific */
+static inline uint8_t _uart_get_char(uint8_t port);                 // TODO your implementation
+static inline void _uart_send_char(uint8_t port, uint8_t c);         // TODO your implementation
+static inline void _uart_send_str(uint8_t port, const uint8_t *str); // TODO your implementation
+
+/* Ucterm callback fuction prototypes - shared by all the sessions */
+static void _print_char(void *user, uint8_t c);
+static void _print_str(void *user, const uint8_t *str);
+static void _execute(void *user, uint8_t argc, uint8_t *argv[]);
+static void _complete(void *user, UcTerm_Completion_t *completion);
+
+/* Command lookup */
+static const CliCommand_t *_find_command(const uint8_t *name);
+static CliMatch_t _match_command(const uint8_t *name);
+static CliMatch_t _match_token(const uint8_t *token, size_t len);
+static void _complete_name(UcTerm_Completion_t *completion);
+static void _print_candidates(CliSession_t *session, const uint8_t *name,
+                              CliMatch_t match);
+#if defined(CLI_USE_PHASH)
+static inline void _narrow(uint16_t *first, uint16_t *last, size_t pos,
+                           uint8_t c);
+static inline const CliCommand_t *_sorted_command(uint16_t i);
+#endif
 
 /* Internal state storage */
 
-static UcTerm_HandleTypeDef _hterm;
+// session of CliInit/CliUpdate
+static CliSession_t _session;
 
-static const CliCommand_t _commands[MAX_CLI_COMMANDS] = {
-    {
-        "help",
-        cmd_help,
-        "List available commands or show details with \x1B[1mhelp <command>\x1B[0m.",
-    },
-    {
-		"uname",
-		cmd_uname,
-		"Display system info."
-	},
-    // TODO add your commands here
+static const UcTerm_Ops _ops = {
+    .printChr = _print_char,
+    .printStr = _print_str,
+    .exec = _execute,
+    .complete = _complete,
 };
 
+#if defined(CLI_USE_SECTION)
+// the built-in commands join the ones of the other modules
+#define CLI_COMMAND_DEF(name, handler, help) CLI_COMMAND(name, handler, help);
+#define CLI_COMMAND_DEF_COMPLETE(name, handler, help, complete) \
+    CLI_COMMAND_COMPLETE(name, handler, help, complete);
+#include CLI_COMMANDS_FILE
+#undef CLI_COMMAND_DEF
+#undef CLI_COMMAND_DEF_COMPLETE
+
+// section bounds, provided by the linker
+extern const CliCommand_t __start_cli_commands[];
+extern const CliCommand_t __stop_cli_commands[];
+
+static const CliCommand_t *const _commands = __start_cli_commands;
+
+// Number of avaiable commands
+#define MAX_CLI_COMMANDS ((uint16_t)(__stop_cli_commands - __start_cli_commands))
+#else
+static const CliCommand_t _commands[] = {
+#define CLI_COMMAND_DEF(name, handler, help) {name, handler, help, NULL},
+#define CLI_COMMAND_DEF_COMPLETE(name, handler, help, complete) \
+    {name, handler, help, complete},
+#include CLI_COMMANDS_FILE
+#undef CLI_COMMAND_DEF
+#undef CLI_COMMAND_DEF_COMPLETE
+};
+
+// Number of avaiable commands
+#define MAX_CLI_COMMANDS (sizeof(_commands) / sizeof(_commands[0]))
+#endif
+
+#if defined(CLI_USE_PHASH)
+_Static_assert(CLI_HASH_COUNT == MAX_CLI_COMMANDS,
+               "cli_commands_phash.h is outdated, run cli_phashgen");
+#endif
+
 /* Public interface implementation */
 
-void CliInit(void)
+void CliSessionInit(CliSession_t *session, uint8_t port)
 {
-    UcTerm_Init(&_hterm);
-    UcTerm_RegisterPrintCharCallback(&_hterm, &_uart_send_char);
-    UcTerm_RegisterPrintStrCallback(&_hterm, &_uart_send_str);
-    UcTerm_RegisterExecuteCallback(&_hterm, &_execute);
-    UcTerm_ShowPrompt(&_hterm);
+    session->port = port;
+#if UCTERM_MAX_STR_LEN > 0
+    UcTerm_Init(&session->term);
+#else
+    UcTerm_InitWithBuffer(&session->term, session->line, sizeof(session->line));
+#endif
+    UcTerm_SetOps(&session->term, &_ops, session);
+    UcTerm_ShowPrompt(&session->term);
 }
 
-void CliUpdate(void)
+void CliSessionUpdate(CliSession_t *session)
 {
     // read char from UART RX buffer and pass it to Ucterm
-    uint8_t c = _uart_get_char();
+    uint8_t c = _uart_get_char(session->port);
     if ('\0' == c)
     {
         return;
     }
-    UcTerm_IngestChar(&_hterm, c);
+    UcTerm_IngestChar(&session->term, c);
+}
+
+void CliInit(void)
+{
+    CliSessionInit(&_session, 0);
+}
+
+void CliUpdate(void)
+{
+    CliSessionUpdate(&_session);
+}
+
+void CliPrint(CliSession_t *session, const char *str)
+{
+    _uart_send_str(session->port, (const uint8_t *)str);
 }
 
 /* Private functions implementation */
 
-static inline void _execute(uint8_t argc, uint8_t *argv[])
+static void _print_char(void *user, uint8_t c)
+{
+    _uart_send_char(((CliSession_t *)user)->port, c);
+}
+
+static void _print_str(void *user, const uint8_t *str)
+{
+    _uart_send_str(((CliSession_t *)user)->port, str);
+}
+
+static void _execute(void *user, uint8_t argc, uint8_t *argv[])
 {
+    CliSession_t *session = (CliSession_t *)user;
+    const CliCommand_t *command;
+    CliMatch_t match;
     if (argc == 0)
     {
         return;
     }
-    for (uint8_t i = 0; i < MAX_CLI_COMMANDS; i++)
+    // a unique prefix is as good as the whole name
+    match = _match_command(argv[0]);
+    command = match.command;
+    if (NULL == command)
+    {
+        if (1 < match.count)
+        {
+            _uart_send_str(session->port, "Ambiguous command:\x1B[1m");
+            _print_candidates(session, argv[0], match);
+            _uart_send_str(session->port, "\x1B[0m");
+            return;
+        }
+        _uart_send_str(session->port, "Unknown command!");
+        return;
+    }
+    // call handler on command name match
+    // or show help if requested
+    if (argc == 2 && argv[1][0] == '-')
+    {
+        if (strcmp((char *)argv[1], "-h") == 0 ||
+            strcmp((char *)argv[1], "--help") == 0)
+        {
+            _uart_send_str(session->port, command->help);
+            return;
+        }
+    }
+    command->handler(session, argc, (const uint8_t **)argv);
+}
+
+static void _complete(void *user, UcTerm_Completion_t *completion)
+{
+    const uint8_t *name = completion->line;
+    size_t len = 0;
+    CliMatch_t match;
+    if (0 == completion->arg_index)
+    {
+        _complete_name(completion);
+        return;
+    }
+    // the arguments are up to the command (typed in full or by prefix)
+    while (' ' == *name)
+    {
+        name++;
+    }
+    while ('\0' != name[len] && ' ' != name[len])
+    {
+        len++;
+    }
+    match = _match_token(name, len);
+    if (NULL != match.command && NULL != match.command->complete)
+    {
+        match.command->complete((CliSession_t *)user, completion);
+    }
+}
+
+static void _complete_name(UcTerm_Completion_t *completion)
+{
+#if defined(CLI_USE_PHASH)
+    // the names in the range of the typed part, in name order
+    uint16_t first = 0;
+    uint16_t last = MAX_CLI_COMMANDS;
+    const uint8_t *token = &completion->line[completion->start];
+    for (size_t pos = 0; pos < completion->length && first < last; pos++)
+    {
+        _narrow(&first, &last, pos, token[pos]);
+    }
+    for (uint16_t i = first; i < last; i++)
+    {
+        if (!UcTerm_CompletionAdd(completion,
+                                  (const uint8_t *)_sorted_command(i)->name))
+        {
+            return;
+        }
+    }
+#else
+    // the names not matching the typed part are skipped
+    for (uint16_t i = 0; i < MAX_CLI_COMMANDS; i++)
+    {
+        if (!UcTerm_CompletionAdd(completion, (const uint8_t *)_commands[i].name))
+        {
+            return;
+        }
+    }
+#endif
+}
+
+static const CliCommand_t *_find_command(const uint8_t *name)
+{
+#if defined(CLI_USE_PHASH)
+    // the only candidate, whatever the table size
+    uint16_t slot = CliHash_Slot(name, _cli_hash_seeds, CLI_HASH_BUCKET_MASK,
+                                 CLI_HASH_SLOT_MASK);
+    uint16_t index = CLI_READ_FLASH_WORD(&_cli_hash_slots[slot]);
+    if (0 != index && strcmp((char *)name, _commands[index - 1].name) == 0)
+    {
+        return &_commands[index - 1];
+    }
+#else
+    for (uint16_t i = 0; i < MAX_CLI_COMMANDS; i++)
     {
         // first symbol pre-filter
-        if (argv[0][0] != _commands[i].name[0])
+        if (name[0] != _commands[i].name[0])
         {
             continue;
         }
-        // call handler on command name match
-        // or show help if requested
-        if (strcmp((char *)argv[0], _commands[i].name) == 0)
+        if (strcmp((char *)name, _commands[i].name) == 0)
+        {
+            return &_commands[i];
+        }
+    }
+#endif
+    return NULL;
+}
+
+static CliMatch_t _match_command(const uint8_t *name)
+{
+    CliMatch_t match = {_find_command(name), 0, 1};
+    if (NULL != match.command)
+    {
+        return match;
+    }
+    return _match_token(name, strlen((char *)name));
+}
+
+static CliMatch_t _match_token(const uint8_t *token, size_t len)
+{
+    CliMatch_t match = {NULL, 0, 0};
+#if defined(CLI_USE_PHASH)
+    uint16_t first = 0;
+    uint16_t last = MAX_CLI_COMMANDS;
+    // the names starting with the prefix make a range in name order,
+    // narrow it down char by char
+    for (size_t pos = 0; pos < len && first < last; pos++)
+    {
+        _narrow(&first, &last, pos, token[pos]);
+    }
+    match.first = first;
+    match.count = last - first;
+    // the whole name is the first one of its range
+    if (0 < match.count && '\0' == _sorted_command(first)->name[len])
+    {
+        match.count = 1;
+    }
+    if (1 == match.count)
+    {
+        match.command = _sorted_command(first);
+    }
+#else
+    for (uint16_t i = 0; i < MAX_CLI_COMMANDS; i++)
+    {
+        if (strncmp((char *)token, _commands[i].name, len) == 0)
         {
-            if (argc == 2 && argv[1][0] == '-')
+            if ('\0' == _commands[i].name[len])
             {
-                if (strcmp((char *)argv[1], "-h") == 0 ||
-                    strcmp((char *)argv[1], "--help") == 0)
-                {
-                    _uart_send_str(_commands[i].help);
-                    return;
-                }
+                match.command = &_commands[i];
+                match.first = i;
+                match.count = 1;
+                return match;
             }
-            _commands[i].handler(argc, (const uint8_t **)argv);
-            return;
+            match.first = (0 == match.count) ? i : match.first;
+            match.count++;
+        }
+    }
+    if (1 == match.count)
+    {
+        match.command = &_commands[match.first];
+    }
+#endif
+    return match;
+}
+
+static void _print_candidates(CliSession_t *session, const uint8_t *name,
+                              CliMatch_t match)
+{
+#if defined(CLI_USE_PHASH)
+    (void)name;
+    for (uint16_t i = match.first; i < match.first + match.count; i++)
+    {
+        _uart_send_char(session->port, '\t');
+        _uart_send_str(session->port, _sorted_command(i)->name);
+    }
+#else
+    size_t len = strlen((char *)name);
+    for (uint16_t i = match.first; i < MAX_CLI_COMMANDS; i++)
+    {
+        if (strncmp((char *)name, _commands[i].name, len) == 0)
+        {
+            _uart_send_char(session->port, '\t');
+            _uart_send_str(session->port, _commands[i].name);
+        }
+    }
+#endif
+}
+
+#if defined(CLI_USE_PHASH)
+static inline const CliCommand_t *_sorted_command(uint16_t i)
+{
+    // i-th command in name order
+    return &_commands[CLI_READ_FLASH_WORD(&_cli_sorted[i])];
+}
+
+static inline void _narrow(uint16_t *first, uint16_t *last, size_t pos,
+                           uint8_t c)
+{
+    // the names of the range share pos chars, so their chars at pos
+    // are ordered: binary search the bounds of c
+    uint16_t lo = *first;
+    uint16_t hi = *last;
+    while (lo < hi)
+    {
+        uint16_t mid = lo + ((hi - lo) >> 1);
+        if ((uint8_t)_sorted_command(mid)->name[pos] < c)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
         }
     }
-    _uart_send_str("Unknown command!");
+    *first = lo;
+    hi = *last;
+    while (lo < hi)
+    {
+        uint16_t mid = lo + ((hi - lo) >> 1);
+        if ((uint8_t)_sorted_command(mid)->name[pos] <= c)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    *last = lo;
 }
+#endif
 
-static inline uint8_t _uart_get_char(void)
+#if !defined(CLI_DRIVER_DEFINED)
+static inline uint8_t _uart_get_char(uint8_t port)
 {
     // TODO read a char from UART or
     // whatever interface you use
+    // (select the UART by the port number)
 }
 
-static inline void _uart_send_char(uint8_t c)
+static inline void _uart_send_char(uint8_t port, uint8_t c)
 {
     // TODO send ch via UART or
     // whatever interface you use
+    // (select the UART by the port number)
 }
 
-static inline void _uart_send_str(const uint8_t *str)
+static inline void _uart_send_str(uint8_t port, const uint8_t *str)
 {
     // TODO send *str via UART or
     // whatever interface you use
+    // (select the UART by the port number)
 }
+#endif
 
 /* Command handlers implementation */
 
-static void cmd_help(uint8_t argc, const uint8_t *argv[])
+static void cmd_help(CliSession_t *session, uint8_t argc, const uint8_t *argv[])
 {
     // if "help <command>" - print help of a particular command;
     // else list available commands
     if (argc == 2)
     {
-        for (uint8_t i = 0; i < MAX_CLI_COMMANDS; i++)
+        const CliCommand_t *command = _match_command(argv[1]).command;
+        if (NULL != command)
         {
-            if (strcmp((char *)argv[1], _commands[i].name) == 0)
-            {
-                _uart_send_str(_commands[i].help);
-                return;
-            }
+            _uart_send_str(session->port, command->help);
+            return;
         }
     }
-    _uart_send_str("Available commands:\x1B[1m");
-    for (uint8_t i = 0; i < MAX_CLI_COMMANDS; i++)
+    _uart_send_str(session->port, "Available commands:\x1B[1m");
+    for (uint16_t i = 0; i < MAX_CLI_COMMANDS; i++)
     {
-        _uart_send_char('\t');
-        _uart_send_str(_commands[i].name);
+        _uart_send_char(session->port, '\t');
+        _uart_send_str(session->port, _commands[i].name);
     }
-    _uart_send_str("\x1B[0m\r\nTry \x1B[1m-h\x1B[0m, \x1B[1m--help\x1B[0m or \x1B[1mhelp <command>\x1B[0m for details.");
+    _uart_send_str(session->port, "\x1B[0m\r\nTry \x1B[1m-h\x1B[0m, \x1B[1m--help\x1B[0m or \x1B[1mhelp <command>\x1B[0m for details.");
+}
+
+static void cmd_uname(CliSession_t *session, uint8_t argc, const uint8_t *argv[])
+{
+    _uart_send_str(session->port, "Hello world!\r\n");
 }
 
-static void cmd_uname(uint8_t argc, const uint8_t *argv[])
+/* Argument completers implementation */
+
+static void complete_help(CliSession_t *session, UcTerm_Completion_t *completion)
 {
-    _uart_send_str("Hello world!\r\n");
+    // "help <command>"
+    (void)session;
+    if (1 == completion->arg_index)
+    {
+        _complete_name(completion);
+    }
 }
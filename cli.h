@@ -8,7 +8,11 @@ coupling it with a physical interface of your choice
 Supports -h, --help or "help <command>" to show info
 on a specific command.
 
-You MUST call CliInit before usage.
+Other modules may register their own commands with CLI_COMMAND
+when the wrapper is built with CLI_USE_SECTION (see below).
+
+You MUST call CliInit (or CliSessionInit for every
+interface, when there are several) before usage.
 
 To ensure smooth CLI behavior without lags, make sure
 that you call CliUpdate frequently enough (at least 3-5 Hz
@@ -21,13 +25,108 @@ for normal typing and 50Hz for press-and-hold key).
 #ifndef CLI_H_
 #define CLI_H_
 
-/// @brief Init the UcTerm wrapper.
-/// This must be called prior to using any functions
-/// of the package.
+#include "ucterm.h"
+#include <stdint.h>
+
+#if UCTERM_MAX_STR_LEN == 0
+/// @brief Input line length of the sessions, when the terminals
+/// are built without the built-in line (UCTERM_MAX_STR_LEN is 0).
+#ifndef CLI_LINE_LEN
+#define CLI_LINE_LEN 80
+#endif
+#endif
+
+/// @brief CLI session - a terminal bound to one physical interface.
+/// Allocate one per interface (i.e. per UART), all of them
+/// are served by the same driver functions in cli.c.
+typedef struct
+{
+    UcTerm_HandleTypeDef term; // terminal state
+#if UCTERM_MAX_STR_LEN == 0
+    uint8_t line[CLI_LINE_LEN + 1]; // input line of the terminal
+#endif
+    uint8_t port;              // interface number passed to the driver
+} CliSession_t;
+
+/// @brief CLI command handler function type
+/// (the session tells the interface to reply to).
+typedef void (*CliCommandHandle_t)(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+
+/// @brief CLI argument completer function type: reports the candidates
+/// of the argument completion->arg_index (typed part at
+/// completion->line + completion->start, completion->length chars)
+/// one by one with UcTerm_CompletionAdd, stopping when it returns 0.
+typedef void (*CliCommandComplete_t)(CliSession_t *session, UcTerm_Completion_t *completion);
+
+/// @brief CLI command definition type.
+typedef struct
+{
+    const char *name;              ///< command name
+    CliCommandHandle_t handler;    ///< function to execute
+    const char *help;              ///< short help string
+    CliCommandComplete_t complete; ///< argument completer or NULL
+} CliCommand_t;
+
+#if defined(CLI_USE_SECTION)
+/// @brief Register a command from any module: a const descriptor
+/// in the cli_commands linker section, found by cli.c at run time.
+/// Declares the handler static and names the descriptor after it,
+/// so each handler serves one command. Use at file scope:
+///
+///     CLI_COMMAND("reg", cmd_reg, "Read a register: reg <addr>");
+///
+/// The GNU linker provides the section bounds on the hosts
+/// (__start_cli_commands, __stop_cli_commands); on the targets,
+/// place the section in flash with the same symbols, i.e.
+///
+///     .cli_commands : {
+///         PROVIDE(__start_cli_commands = .);
+///         KEEP(*(cli_commands))
+///         PROVIDE(__stop_cli_commands = .);
+///     } > FLASH
+///
+/// Limitation: cli.c reads the descriptors as plain data, so on Harvard
+/// targets (AVR) they can't stay in flash only. Put the section into
+/// the .data output section (copied from flash at startup) instead:
+/// each command then costs sizeof(CliCommand_t) (8 bytes) of RAM there,
+/// as the cli_commands.def table of the other builds does.
+#define CLI_COMMAND(name, handler, help) \
+    CLI_COMMAND_COMPLETE(name, handler, help, NULL)
+
+/// @brief Register a command with an argument completer
+/// (see CLI_COMMAND and CliCommandComplete_t).
+#define CLI_COMMAND_COMPLETE(name, handler, help, complete)                    \
+    static void handler(CliSession_t *session, uint8_t argc,                 \
+                        const uint8_t *argv[]);                              \
+    static const CliCommand_t _cli_command_##handler                         \
+        __attribute__((used, section("cli_commands"),                        \
+                       aligned(sizeof(void *)))) = {name, handler, help, complete}
+#endif
+
+/// @brief Print a string to the session's interface
+/// (for the command handlers outside cli.c).
+/// @param session  Session passed to the handler.
+/// @param str      Null-terminated string.
+void CliPrint(CliSession_t *session, const char *str);
+
+/// @brief Init a CLI session on the given interface.
+/// This must be called prior to using the session.
+/// @param session  Session storage, must outlive its usage.
+/// @param port     Interface number passed to the driver functions.
+void CliSessionInit(CliSession_t *session, uint8_t port);
+
+/// @brief Consume the input character from the session's
+/// interface buffer and pass it to its terminal.
+/// Call this in a loop or a timer interrupt.
+/// @param session  Session initialized with CliSessionInit.
+void CliSessionUpdate(CliSession_t *session);
+
+/// @brief Init the UcTerm wrapper on the interface 0.
+/// This must be called prior to using CliUpdate.
 void CliInit(void);
 
-/// @brief Consume the input character from the UART buffer
-/// and pass it to the UcTerm wrapper.
+/// @brief Consume the input character from the interface 0
+/// buffer and pass it to the UcTerm wrapper.
 /// Call this in a loop or a timer interrupt.
 void CliUpdate(void);
 
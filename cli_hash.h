@@ -0,0 +1,74 @@
+/*
+Command name hashing of the CLI wrapper - the runtime part
+of the perfect hash table generated at build time by
+tools/cli_phashgen from cli_commands.def.
+
+A name is looked up with a single pass over its chars and
+a single compare with the candidate command, whatever the
+table size. Uses shifts, xors and multiplications only
+(no division).
+*/
+
+#ifndef CLI_HASH_H_
+#define CLI_HASH_H_
+
+#include <stdint.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+// keep the generated tables in flash
+#define CLI_FLASH_CONST              const PROGMEM
+#define CLI_READ_FLASH_BYTE(address) pgm_read_byte(address)
+#define CLI_READ_FLASH_WORD(address) pgm_read_word(address)
+#else
+#define CLI_FLASH_CONST              const
+#define CLI_READ_FLASH_BYTE(address) (*(address))
+#define CLI_READ_FLASH_WORD(address) (*(address))
+#endif
+
+/// @brief Hash a null-terminated command name (djb2, xor variant).
+/// @param s    Command name.
+/// @return Name hash, scrambled with CliHash_Mix before use.
+static inline uint32_t CliHash_Name(const uint8_t *s)
+{
+    uint32_t h = 5381;
+    while ('\0' != *s)
+    {
+        h = ((h << 5) + h) ^ *(s++);
+    }
+    return h;
+}
+
+/// @brief Scramble the name hash with a seed
+/// (the 32-bit finalizer of MurmurHash3).
+/// @param h    Name hash (see CliHash_Name).
+/// @param seed Bucket seed, 0 selects the bucket itself.
+/// @return Scrambled hash.
+static inline uint32_t CliHash_Mix(uint32_t h, uint32_t seed)
+{
+    h ^= seed * 0x9E3779B9u;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/// @brief Find the table slot of a command name.
+/// The slot holds the only command the name may match
+/// (compare the names to tell).
+/// @param s            Command name.
+/// @param seeds        Bucket seeds of the table (CLI_FLASH_CONST).
+/// @param bucket_mask  Bucket count - 1 (a power of 2 - 1).
+/// @param slot_mask    Slot count - 1 (a power of 2 - 1).
+/// @return Slot index.
+static inline uint16_t CliHash_Slot(const uint8_t *s, const uint8_t *seeds,
+                                    uint16_t bucket_mask, uint16_t slot_mask)
+{
+    uint32_t h = CliHash_Name(s);
+    uint8_t seed = CLI_READ_FLASH_BYTE(&seeds[CliHash_Mix(h, 0) & bucket_mask]);
+    return (uint16_t)(CliHash_Mix(h, (uint32_t)seed + 1) & slot_mask);
+}
+
+#endif // CLI_HASH_H_
@@ -0,0 +1,48 @@
+/*
+Configuration of cli.c in test_cli.c: the command list of the tests
+and the interface driver reading and recording the test strings.
+*/
+
+#ifndef CLI_TEST_CONFIG_H_
+#define CLI_TEST_CONFIG_H_
+
+#include "cli.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// With CLI_USE_SECTION the built-in commands come from cli_commands.def
+// and the others from cli_test_section.c.
+#if !defined(CLI_USE_SECTION)
+#define CLI_COMMANDS_FILE "cli_test_commands.def"
+#endif
+
+/* Command handlers of the list (test_cli.c) */
+void test_cmd_diag(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+void test_cmd_diag_reset(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+void test_cmd_dump(CliSession_t *session, uint8_t argc, const uint8_t *argv[]);
+void test_complete_dump(CliSession_t *session, UcTerm_Completion_t *completion);
+
+/* Interface driver */
+#define CLI_DRIVER_DEFINED
+
+extern const uint8_t *cli_test_input; // the rest of the typed keys
+void cli_test_output(uint8_t port, const uint8_t *data, size_t len);
+
+static inline uint8_t _uart_get_char(uint8_t port)
+{
+    (void)port;
+    return ('\0' == *cli_test_input) ? '\0' : *cli_test_input++;
+}
+
+static inline void _uart_send_char(uint8_t port, uint8_t c)
+{
+    cli_test_output(port, &c, 1);
+}
+
+static inline void _uart_send_str(uint8_t port, const uint8_t *str)
+{
+    cli_test_output(port, str, strlen((const char *)str));
+}
+
+#endif // CLI_TEST_CONFIG_H_
@@ -0,0 +1,32 @@
+/*
+The commands of cli_test_commands.def but help and uname, registered
+from this module with CLI_COMMAND for the CLI_USE_SECTION build
+of test_cli.c (cli_tests_section).
+*/
+
+#include "cli.h"
+#include "cli_test_config.h"
+
+CLI_COMMAND("diag_reset", section_cmd_diag_reset, "Reset the diagnostics.");
+CLI_COMMAND_COMPLETE("dump", section_cmd_dump,
+                     "Dump a memory: dump <memory> <format>",
+                     test_complete_dump);
+CLI_COMMAND("diag", section_cmd_diag, "Show the diagnostics.");
+
+static void section_cmd_diag_reset(CliSession_t *session, uint8_t argc,
+                                   const uint8_t *argv[])
+{
+    test_cmd_diag_reset(session, argc, argv);
+}
+
+static void section_cmd_dump(CliSession_t *session, uint8_t argc,
+                             const uint8_t *argv[])
+{
+    test_cmd_dump(session, argc, argv);
+}
+
+static void section_cmd_diag(CliSession_t *session, uint8_t argc,
+                             const uint8_t *argv[])
+{
+    test_cmd_diag(session, argc, argv);
+}
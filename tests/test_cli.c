@@ -0,0 +1,307 @@
+#include "./unity/unity.h"
+#include "../cli.h"
+#include "cli_test_config.h"
+#include <stdint.h>
+#include <string.h>
+
+// cli.c is built with the command list of cli_test_commands.def
+// (see cli_test_config.h), scanned or looked up with the perfect hash
+// (cli_tests and cli_tests_phash), or with the same commands registered
+// from cli_test_section.c (cli_tests_section); the same tests pass on all.
+
+#define TEST_PORT 3
+
+static CliSession_t session;
+
+/* Interface emulation */
+
+#define MAX_OUTPUT_LEN 1024
+
+const uint8_t *cli_test_input = (const uint8_t *)"";
+static char output[MAX_OUTPUT_LEN + 1];
+static size_t output_len;
+
+void cli_test_output(uint8_t port, const uint8_t *data, size_t len)
+{
+    TEST_ASSERT_EQUAL_UINT8(TEST_PORT, port);
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(MAX_OUTPUT_LEN - output_len, len);
+    memcpy(&output[output_len], data, len);
+    output_len += len;
+    output[output_len] = '\0';
+}
+
+// Type the keys on the session's interface, the output starts anew.
+static void _type(const char *keys)
+{
+    output_len = 0;
+    output[0] = '\0';
+    cli_test_input = (const uint8_t *)keys;
+    while ('\0' != *cli_test_input)
+    {
+        CliSessionUpdate(&session);
+    }
+}
+
+// Whether the name is one of the Tab separated list
+// (started by a Tab or a new line, ended by an ESC).
+static int _listed(const char *list, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *item = strstr(list, name); NULL != item;
+         item = strstr(item + 1, name))
+    {
+        if (item > list && ('\t' == item[-1] || '\n' == item[-1]) &&
+            ('\t' == item[len] || '\x1B' == item[len]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Command handlers - reply with the name and the arguments */
+
+static void _reply(CliSession_t *s, const char *name, uint8_t argc,
+                   const uint8_t *argv[])
+{
+    CliPrint(s, "<");
+    CliPrint(s, name);
+    for (uint8_t i = 1; i < argc; i++)
+    {
+        CliPrint(s, " ");
+        CliPrint(s, (const char *)argv[i]);
+    }
+    CliPrint(s, ">");
+}
+
+void test_cmd_diag(CliSession_t *s, uint8_t argc, const uint8_t *argv[])
+{
+    _reply(s, "diag", argc, argv);
+}
+
+void test_cmd_diag_reset(CliSession_t *s, uint8_t argc, const uint8_t *argv[])
+{
+    _reply(s, "diag_reset", argc, argv);
+}
+
+void test_cmd_dump(CliSession_t *s, uint8_t argc, const uint8_t *argv[])
+{
+    _reply(s, "dump", argc, argv);
+}
+
+/* Argument completer of dump - memories, then formats */
+
+static const char *const memories[] = {"flash", "fram", "ram",
+                                       "rom", "eeprom", "otp"};
+static const char *const formats[] = {"hex", "bin"};
+static uint8_t completion_arg_index;
+static size_t completion_calls;
+static size_t completion_offered; // candidates of the last call
+
+void test_complete_dump(CliSession_t *s, UcTerm_Completion_t *completion)
+{
+    const char *const *words = memories;
+    size_t count = sizeof(memories) / sizeof(memories[0]);
+    TEST_ASSERT_EQUAL_PTR(&session, s);
+    completion_arg_index = completion->arg_index;
+    completion_calls++;
+    completion_offered = 0;
+    if (2 == completion->arg_index)
+    {
+        words = formats;
+        count = sizeof(formats) / sizeof(formats[0]);
+    }
+    else if (1 != completion->arg_index)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        completion_offered++;
+        if (!UcTerm_CompletionAdd(completion, (const uint8_t *)words[i]))
+        {
+            return;
+        }
+    }
+}
+
+void setUp(void)
+{
+    output_len = 0;
+    completion_arg_index = 0;
+    completion_calls = 0;
+    completion_offered = 0;
+    CliSessionInit(&session, TEST_PORT);
+}
+
+void tearDown(void)
+{
+}
+
+/* Command lookup */
+
+void test_exact_match_runs_command(void)
+{
+    _type("dump 10\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump 10>"));
+    _type("uname\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Hello world!"));
+}
+
+void test_unique_prefix_runs_command(void)
+{
+    _type("du 10\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump 10>"));
+    _type("diag_r\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<diag_reset>"));
+    _type("u\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Hello world!"));
+}
+
+void test_ambiguous_prefix_lists_candidates(void)
+{
+    const char *list;
+    _type("d\r");
+    list = strstr(output, "Ambiguous command:\x1B[1m");
+    TEST_ASSERT_NOT_NULL(list);
+    TEST_ASSERT_TRUE(_listed(list, "diag"));
+    TEST_ASSERT_TRUE(_listed(list, "diag_reset"));
+    TEST_ASSERT_TRUE(_listed(list, "dump"));
+    TEST_ASSERT_FALSE(_listed(list, "uname"));
+    TEST_ASSERT_NULL(strchr(output, '<'));
+    // a longer prefix leaves fewer candidates
+    _type("dia\r");
+    list = strstr(output, "Ambiguous command:\x1B[1m");
+    TEST_ASSERT_NOT_NULL(list);
+    TEST_ASSERT_TRUE(_listed(list, "diag"));
+    TEST_ASSERT_TRUE(_listed(list, "diag_reset"));
+    TEST_ASSERT_FALSE(_listed(list, "dump"));
+}
+
+void test_no_match_is_unknown(void)
+{
+    _type("x\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Unknown command!"));
+    // longer than any name starting the same
+    _type("diagx\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Unknown command!"));
+    _type("dumpx\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Unknown command!"));
+    TEST_ASSERT_NULL(strchr(output, '<'));
+}
+
+void test_name_prefix_of_another_matches_exactly(void)
+{
+    // diag is the whole name, not an ambiguous prefix of diag_reset
+    _type("diag\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<diag>"));
+    TEST_ASSERT_NULL(strstr(output, "Ambiguous"));
+    _type("diag 1\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<diag 1>"));
+    _type("diag_\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<diag_reset>"));
+    _type("help diag\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Show the diagnostics."));
+    _type("diag -h\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Show the diagnostics."));
+}
+
+/* Tab completion */
+
+void test_tab_completes_command_name(void)
+{
+    _type("dum\t");
+    TEST_ASSERT_EQUAL_STRING("dump ", output);
+    TEST_ASSERT_EQUAL_size_t(0, completion_calls);
+    _type("\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump>"));
+}
+
+void test_tab_routes_argument_index_to_completer(void)
+{
+    _type("dump fl\t");
+    TEST_ASSERT_EQUAL_STRING("dump flash ", output);
+    TEST_ASSERT_EQUAL_size_t(1, completion_calls);
+    TEST_ASSERT_EQUAL_UINT8(1, completion_arg_index);
+    _type("h\t");
+    TEST_ASSERT_EQUAL_STRING("hex ", output);
+    TEST_ASSERT_EQUAL_size_t(2, completion_calls);
+    TEST_ASSERT_EQUAL_UINT8(2, completion_arg_index);
+    _type("\t");
+    TEST_ASSERT_EQUAL_UINT8(3, completion_arg_index);
+    _type("\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump flash hex>"));
+}
+
+void test_tab_routes_by_command_prefix(void)
+{
+    // the command typed by a unique prefix
+    _type("du e\t\r");
+    TEST_ASSERT_EQUAL_size_t(1, completion_calls);
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump eeprom>"));
+    // the commands without a completer
+    completion_calls = 0;
+    _type("diag \t");
+    _type("d \t");
+    _type("x \t");
+    TEST_ASSERT_EQUAL_size_t(0, completion_calls);
+}
+
+void test_tab_skips_candidates_shorter_than_token(void)
+{
+    _type("dump eepromxyz");
+    _type("\t");
+    TEST_ASSERT_EQUAL_size_t(1, completion_calls);
+    TEST_ASSERT_EQUAL_STRING("", output);
+    _type("\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "<dump eepromxyz>"));
+}
+
+void test_tab_completer_stops_when_add_returns_0(void)
+{
+    // flash and fram share f, ram leaves nothing to insert
+    _type("dump ");
+    _type("\t");
+    TEST_ASSERT_EQUAL_STRING("", output);
+    TEST_ASSERT_EQUAL_size_t(3, completion_offered);
+    // the second Tab lists them all
+    _type("\t");
+    TEST_ASSERT_EQUAL_size_t(6, completion_offered);
+    for (size_t i = 0; i < sizeof(memories) / sizeof(memories[0]); i++)
+    {
+        TEST_ASSERT_TRUE(_listed(output, memories[i]));
+    }
+}
+
+void test_help_tab_lists_command_names(void)
+{
+    _type("help \t\t");
+    TEST_ASSERT_TRUE(_listed(output, "help"));
+    TEST_ASSERT_TRUE(_listed(output, "uname"));
+    TEST_ASSERT_TRUE(_listed(output, "diag"));
+    TEST_ASSERT_TRUE(_listed(output, "diag_reset"));
+    TEST_ASSERT_TRUE(_listed(output, "dump"));
+    TEST_ASSERT_EQUAL_size_t(0, completion_calls);
+    // and completes them
+    _type("diag_\t");
+    TEST_ASSERT_EQUAL_STRING("diag_reset ", output);
+    _type("\r");
+    TEST_ASSERT_NOT_NULL(strstr(output, "Reset the diagnostics."));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_exact_match_runs_command);
+    RUN_TEST(test_unique_prefix_runs_command);
+    RUN_TEST(test_ambiguous_prefix_lists_candidates);
+    RUN_TEST(test_no_match_is_unknown);
+    RUN_TEST(test_name_prefix_of_another_matches_exactly);
+    RUN_TEST(test_tab_completes_command_name);
+    RUN_TEST(test_tab_routes_argument_index_to_completer);
+    RUN_TEST(test_tab_routes_by_command_prefix);
+    RUN_TEST(test_tab_skips_candidates_shorter_than_token);
+    RUN_TEST(test_tab_completer_stops_when_add_returns_0);
+    RUN_TEST(test_help_tab_lists_command_names);
+    return UNITY_END();
+}
@@ -1,6 +1,7 @@
 #include "./unity/unity.h"
 #include "../ucterm.h"
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 // keyboard special keys
@@ -22,15 +23,20 @@
 #define CTRL_U 0x15 // Delete to beginning of line
 #define CTRL_W 0x17 // Delete previous word
 
+// strcpy_s is only guaranteed by the Windows toolchains
+#if !defined(_WIN32) && !defined(__STDC_LIB_EXT1__)
+#define strcpy_s(dest, size, src) strncpy((char *)(dest), (const char *)(src), (size))
+#endif
+
 static UcTerm_HandleTypeDef hucterm;
 
 /* Output emulation */
 
-#define MAX_ARG_COUNT 4
-#define MAX_STR_LEN 120
+#define MAX_ARG_COUNT UCTERM_MAX_ARG_COUNT
+#define MAX_STR_LEN UCTERM_MAX_STR_LEN
 
 uint8_t buff[MAX_STR_LEN];
-uint8_t buff_index = 0;
+size_t buff_index = 0;
 uint8_t argc = 0;
 uint8_t *argv[MAX_ARG_COUNT];
 
@@ -69,8 +75,297 @@ void execute(uint8_t ac, uint8_t *av[])
     }
 }
 
+/* Output recording - keeps everything printed in order */
+
+#define MAX_TRANSCRIPT_LEN 2048
+
+uint8_t transcript[MAX_TRANSCRIPT_LEN];
+size_t transcript_len = 0;
+
+void recordChar(uint8_t c)
+{
+    if (transcript_len < MAX_TRANSCRIPT_LEN)
+    {
+        transcript[transcript_len++] = c;
+    }
+}
+
+void recordStr(const uint8_t *s)
+{
+    while (*s != '\0')
+    {
+        recordChar(*(s++));
+    }
+}
+
+void recordExecute(uint8_t ac, uint8_t *av[])
+{
+    recordChar('{');
+    for (uint8_t i = 0; i < ac; i++)
+    {
+        recordStr(av[i]);
+        recordChar('|');
+    }
+    recordChar('}');
+}
+
+size_t frame_count = 0;
+size_t frame_max_len = 0;
+
+void recordBuf(const uint8_t *data, size_t len)
+{
+    frame_count++;
+    if (frame_max_len < len)
+    {
+        frame_max_len = len;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        recordChar(data[i]);
+    }
+}
+
+// the engine needs this much free ring space to accept an input char
+#define RING_HEADROOM (MAX_STR_LEN + 16)
+
+static uint8_t out_ring[RING_HEADROOM + 24];
+
+static inline void _drain_ring(size_t chunk)
+{
+    uint8_t tx[16];
+    size_t n;
+    while ((n = UcTerm_ReadOutput(&hucterm, tx, chunk)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            recordChar(tx[i]);
+        }
+    }
+}
+
+void drainingExecute(uint8_t ac, uint8_t *av[])
+{
+    // the queued echo must precede the command output
+    _drain_ring(16);
+    recordExecute(ac, av);
+}
+
+/* Terminal emulation - tracks the current line on the screen */
+
+#define SCREEN_WIDTH 256
+
+uint8_t screen[SCREEN_WIDTH + 1];
+size_t screen_col = 0;
+
+static void _emulate_terminal(const uint8_t *data, size_t len)
+{
+    size_t param = 0;
+    uint8_t state = 0; // 0 - text, 1 - ESC received, 2 - CSI
+    memset(screen, ' ', SCREEN_WIDTH);
+    screen[SCREEN_WIDTH] = '\0';
+    screen_col = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        if (1 == state)
+        {
+            state = ('[' == c) ? 2 : 0;
+            param = 0;
+            continue;
+        }
+        if (2 == state)
+        {
+            if ('0' <= c && '9' >= c)
+            {
+                param = param * 10 + (c - '0');
+                continue;
+            }
+            size_t n = (0 == param) ? 1 : param;
+            switch (c)
+            {
+            case 'C':
+                screen_col += n;
+                break;
+            case 'D':
+                screen_col = (screen_col > n) ? (screen_col - n) : 0;
+                break;
+            case 'G':
+                screen_col = n - 1;
+                break;
+            case 'K':
+                memset(&screen[screen_col], ' ', SCREEN_WIDTH - screen_col);
+                break;
+            case '@':
+                memmove(&screen[screen_col + n], &screen[screen_col],
+                        SCREEN_WIDTH - screen_col - n);
+                memset(&screen[screen_col], ' ', n);
+                break;
+            case 'P':
+                memmove(&screen[screen_col], &screen[screen_col + n],
+                        SCREEN_WIDTH - screen_col - n);
+                memset(&screen[SCREEN_WIDTH - n], ' ', n);
+                break;
+            default:
+                break;
+            }
+            state = 0;
+            continue;
+        }
+        if (0x1B == c)
+        {
+            state = 1;
+        }
+        else if ('\r' == c)
+        {
+            screen_col = 0;
+        }
+        else if ('\n' == c)
+        {
+            // new line: forget the previous one
+            memset(screen, ' ', SCREEN_WIDTH);
+        }
+        else if (0x08 == c || 0x7F == c)
+        {
+            screen_col = (screen_col > 0) ? (screen_col - 1) : 0;
+        }
+        else if (0x20 <= c && screen_col < SCREEN_WIDTH)
+        {
+            screen[screen_col++] = c;
+        }
+    }
+    // trim trailing spaces
+    for (size_t i = SCREEN_WIDTH; i > 0 && ' ' == screen[i - 1]; i--)
+    {
+        screen[i - 1] = '\0';
+    }
+}
+
+#if !UCTERM_LEGACY_CALLBACKS
+/* UcTerm_Register*Callback on top of UcTerm_SetOps, so the same tests
+   run against the engine built without them (unit_tests_ops_only) */
+
+typedef struct
+{
+    UcTerm_HandleTypeDef *handle;
+    void (*printChr)(uint8_t);
+    void (*printStr)(const uint8_t *);
+    void (*printBuf)(const uint8_t *, size_t);
+    void (*exec)(uint8_t, uint8_t **);
+} LegacyCallbacks_t;
+
+static LegacyCallbacks_t legacy[4];
+
+static void legacyChar(void *user, uint8_t c)
+{
+    ((LegacyCallbacks_t *)user)->printChr(c);
+}
+
+static void legacyStr(void *user, const uint8_t *s)
+{
+    ((LegacyCallbacks_t *)user)->printStr(s);
+}
+
+static void legacyBuf(void *user, const uint8_t *data, size_t len)
+{
+    ((LegacyCallbacks_t *)user)->printBuf(data, len);
+}
+
+static void legacyExecute(void *user, uint8_t ac, uint8_t *av[])
+{
+    ((LegacyCallbacks_t *)user)->exec(ac, av);
+}
+
+static const UcTerm_Ops legacy_ops = {
+    .printChr = &legacyChar,
+    .printStr = &legacyStr,
+    .exec = &legacyExecute,
+};
+
+static const UcTerm_Ops legacy_ops_framed = {
+    .printChr = &legacyChar,
+    .printStr = &legacyStr,
+    .printBuf = &legacyBuf,
+    .exec = &legacyExecute,
+};
+
+// The callbacks of the instance, none after its init.
+static LegacyCallbacks_t *_legacy(UcTerm_HandleTypeDef *self)
+{
+    for (size_t i = 0; i < sizeof(legacy) / sizeof(legacy[0]); i++)
+    {
+        if (self == legacy[i].handle || NULL == legacy[i].handle)
+        {
+            legacy[i].handle = self;
+            return &legacy[i];
+        }
+    }
+    TEST_FAIL_MESSAGE("too many instances");
+    return NULL;
+}
+
+static void _legacy_bind(UcTerm_HandleTypeDef *self)
+{
+    LegacyCallbacks_t *callbacks = _legacy(self);
+    UcTerm_SetOps(self,
+                  (NULL != callbacks->printBuf) ? &legacy_ops_framed
+                                                : &legacy_ops,
+                  callbacks);
+}
+
+static void _legacy_init(UcTerm_HandleTypeDef *self)
+{
+    LegacyCallbacks_t *callbacks = _legacy(self);
+    memset(callbacks, 0, sizeof(LegacyCallbacks_t));
+    callbacks->handle = self;
+}
+
+#define UcTerm_Init(self) (_legacy_init(self), (UcTerm_Init)(self))
+#define UcTerm_InitWithBuffer(self, line, cap) \
+    (_legacy_init(self), (UcTerm_InitWithBuffer)(self, line, cap))
+
+void UcTerm_RegisterPrintCharCallback(UcTerm_HandleTypeDef *self,
+                                      void (*printChr)(uint8_t))
+{
+    _legacy(self)->printChr = printChr;
+    _legacy_bind(self);
+}
+
+void UcTerm_RegisterPrintStrCallback(UcTerm_HandleTypeDef *self,
+                                     void (*printStr)(const uint8_t *))
+{
+    _legacy(self)->printStr = printStr;
+    _legacy_bind(self);
+}
+
+void UcTerm_RegisterPrintBufCallback(UcTerm_HandleTypeDef *self,
+                                     void (*printBuf)(const uint8_t *, size_t))
+{
+    _legacy(self)->printBuf = printBuf;
+    _legacy_bind(self);
+}
+
+void UcTerm_RegisterExecuteCallback(UcTerm_HandleTypeDef *self,
+                                    void (*exec)(uint8_t, uint8_t **))
+{
+    _legacy(self)->exec = exec;
+    _legacy_bind(self);
+}
+#endif
+
 /* Private helpers */
 
+static inline void _init_recording(void)
+{
+    frame_count = 0;
+    frame_max_len = 0;
+    transcript_len = 0;
+    memset(transcript, '\0', MAX_TRANSCRIPT_LEN);
+    UcTerm_Init(&hucterm);
+    UcTerm_RegisterPrintCharCallback(&hucterm, &recordChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &recordStr);
+    UcTerm_RegisterExecuteCallback(&hucterm, &recordExecute);
+}
+
 static inline void _ingest_string(uint8_t *s)
 {
     for (uint8_t c = '\0'; (c = *(s++)) != '\0';)
@@ -743,6 +1038,1259 @@ void test_ctrl_k_middle_pos(void)
     TEST_ASSERT_EQUAL_STRING("ab", argv[0]);
 }
 
+/* Buffer ingestion must match char-by-char ingestion */
+
+static const uint8_t differential_input[] =
+    "comm arg\r"
+    "abcd\x1B[D\x1B[DXY\x08\x7F\x1B[3~\x1B[1~>\x1B[4~<\n"
+    "\x02\x06\x01\x05\x0B\x15 word\x01\x06\x06\x0B\x05\x15\r"
+    "\x1B[99~\x1B[12345~[x]\x1Bq\x1B\x1B[C\r"
+    "0123456789012345678901234567890123456789012345678901234567890123456789"
+    "0123456789012345678901234567890123456789012345678901234567890123456789"
+    "tail\x01head \r";
+
+static void _check_buffer_ingestion(size_t chunk)
+{
+    static uint8_t expected[MAX_TRANSCRIPT_LEN];
+    static UcTerm_HandleTypeDef expected_state;
+    size_t expected_len;
+    size_t len = sizeof(differential_input) - 1;
+
+    _init_recording();
+    for (size_t i = 0; i < len; i++)
+    {
+        UcTerm_IngestChar(&hucterm, differential_input[i]);
+    }
+    memcpy(expected, transcript, MAX_TRANSCRIPT_LEN);
+    expected_len = transcript_len;
+    expected_state = hucterm;
+
+    _init_recording();
+    for (size_t i = 0; i < len; i += chunk)
+    {
+        UcTerm_IngestBuffer(&hucterm, &differential_input[i],
+                            (len - i) < chunk ? (len - i) : chunk);
+    }
+
+    TEST_ASSERT_EQUAL_size_t(expected_len, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, transcript, expected_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected_state.storage, hucterm.storage,
+                             UCTERM_STORAGE_SIZE);
+}
+
+void test_ingest_buffer_whole(void)
+{
+    _check_buffer_ingestion(sizeof(differential_input));
+}
+
+void test_ingest_buffer_chunks(void)
+{
+    _check_buffer_ingestion(1);
+    _check_buffer_ingestion(3);
+    _check_buffer_ingestion(16);
+    _check_buffer_ingestion(64);
+}
+
+void test_ingest_buffer_empty(void)
+{
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, (const uint8_t *)"", 0);
+
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+}
+
+/* PrintBuf mode must coalesce the output */
+
+void test_print_buf_matches_char_output(void)
+{
+    static uint8_t expected[MAX_TRANSCRIPT_LEN];
+    size_t expected_len;
+    size_t len = sizeof(differential_input) - 1;
+
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+    memcpy(expected, transcript, MAX_TRANSCRIPT_LEN);
+    expected_len = transcript_len;
+
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    for (size_t i = 0; i < len; i++)
+    {
+        UcTerm_IngestChar(&hucterm, differential_input[i]);
+    }
+
+    TEST_ASSERT_EQUAL_size_t(expected_len, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, transcript, expected_len);
+}
+
+void test_print_buf_without_frame(void)
+{
+    // UCTERM_MAX_FRAME_LEN 0: a call per char, nothing held back
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    frame_count = 0;
+    _ingest_string("abcd\x1B[D\x1B[DX\x7F");
+    TEST_ASSERT_EQUAL_size_t(transcript_len, frame_count);
+    TEST_ASSERT_NOT_EQUAL(0, frame_count);
+}
+
+void test_print_buf_single_frame_per_event(void)
+{
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    _ingest_string("abcd\x1B[D\x1B[D");
+    frame_count = 0;
+
+    // insert in the middle: erase, tail, cursor return and echo
+    UcTerm_IngestChar(&hucterm, 'X');
+
+    TEST_ASSERT_EQUAL_size_t(1, frame_count);
+}
+
+void test_print_buf_single_frame_per_buffer(void)
+{
+    static const char s[] = "abcd\x1B[D\x1B[DX\x7F";
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    UcTerm_IngestBuffer(&hucterm, s, sizeof(s) - 1);
+
+    TEST_ASSERT_EQUAL_size_t(1, frame_count);
+}
+
+void test_print_buf_splits_at_mtu(void)
+{
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    UcTerm_SetFrameMtu(&hucterm, 8);
+    UcTerm_IngestBuffer(&hucterm, "0123456789abcdefghij\x01", 21);
+    transcript_len = 0;
+    frame_count = 0;
+
+    UcTerm_IngestChar(&hucterm, 'X');
+
+    TEST_ASSERT_EQUAL_size_t(8, frame_max_len);
+    TEST_ASSERT_EQUAL_size_t((transcript_len + 7) / 8, frame_count);
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[K00123456789abcdefghij\x1B[2GX",
+                             transcript, transcript_len);
+}
+
+void test_print_buf_flushes_before_execute(void)
+{
+    _init_recording();
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    UcTerm_IngestBuffer(&hucterm, "cmd\r", 4);
+
+    TEST_ASSERT_EQUAL_MEMORY("cmd\r\n{cmd|}", transcript, 11);
+}
+
+/* Output ring mode */
+
+void test_output_ring_matches_char_output(void)
+{
+    static uint8_t expected[MAX_TRANSCRIPT_LEN];
+    size_t expected_len;
+    size_t len = sizeof(differential_input) - 1;
+
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+    memcpy(expected, transcript, MAX_TRANSCRIPT_LEN);
+    expected_len = transcript_len;
+
+    _init_recording();
+    UcTerm_SetOutputRing(&hucterm, out_ring, sizeof(out_ring));
+    UcTerm_RegisterExecuteCallback(&hucterm, &drainingExecute);
+    for (size_t i = 0; i < len; i++)
+    {
+        // a slow transmitter: drain only when the input is paused
+        while (UcTerm_IsBusy(&hucterm))
+        {
+            uint8_t tx[7];
+            size_t n = UcTerm_ReadOutput(&hucterm, tx, sizeof(tx));
+            for (size_t j = 0; j < n; j++)
+            {
+                recordChar(tx[j]);
+            }
+        }
+        UcTerm_IngestChar(&hucterm, differential_input[i]);
+    }
+    _drain_ring(5);
+
+    TEST_ASSERT_EQUAL_size_t(expected_len, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, transcript, expected_len);
+}
+
+void test_output_ring_ingest_buffer_stops_when_busy(void)
+{
+    static uint8_t expected[MAX_TRANSCRIPT_LEN];
+    size_t expected_len;
+    size_t len = sizeof(differential_input) - 1;
+    size_t done = 0;
+    size_t calls = 0;
+
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+    memcpy(expected, transcript, MAX_TRANSCRIPT_LEN);
+    expected_len = transcript_len;
+
+    _init_recording();
+    UcTerm_SetOutputRing(&hucterm, out_ring, RING_HEADROOM + 24);
+    UcTerm_RegisterExecuteCallback(&hucterm, &drainingExecute);
+    while (done < len)
+    {
+        done += UcTerm_IngestBuffer(&hucterm, &differential_input[done],
+                                    len - done);
+        calls++;
+        _drain_ring(16);
+    }
+
+    // the rest waited for the ring, nothing is lost
+    TEST_ASSERT_GREATER_THAN_size_t(1, calls);
+    TEST_ASSERT_EQUAL_size_t(expected_len, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, transcript, expected_len);
+}
+
+void test_output_ring_busy(void)
+{
+    _init_recording();
+    UcTerm_SetOutputRing(&hucterm, out_ring, RING_HEADROOM + 14);
+
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_IsBusy(&hucterm));
+
+    _ingest_string("abcdefghijklm");
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_IsBusy(&hucterm));
+
+    UcTerm_IngestChar(&hucterm, 'n');
+    TEST_ASSERT_EQUAL_UINT8(1, UcTerm_IsBusy(&hucterm));
+
+    _drain_ring(16);
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_IsBusy(&hucterm));
+    TEST_ASSERT_EQUAL_STRING("abcdefghijklmn", transcript);
+}
+
+void test_output_ring_partial_read(void)
+{
+    uint8_t tx[4];
+    _init_recording();
+    UcTerm_SetOutputRing(&hucterm, out_ring, sizeof(out_ring));
+    _ingest_string("abcdef");
+
+    TEST_ASSERT_EQUAL_size_t(4, UcTerm_ReadOutput(&hucterm, tx, 4));
+    TEST_ASSERT_EQUAL_MEMORY("abcd", tx, 4);
+    TEST_ASSERT_EQUAL_size_t(2, UcTerm_ReadOutput(&hucterm, tx, 4));
+    TEST_ASSERT_EQUAL_MEMORY("ef", tx, 2);
+    TEST_ASSERT_EQUAL_size_t(0, UcTerm_ReadOutput(&hucterm, tx, 4));
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+}
+
+/* Cursor motion must take the least bytes */
+
+static size_t _count_output(uint8_t *input)
+{
+    transcript_len = 0;
+    _ingest_string(input);
+    return transcript_len;
+}
+
+void test_motion_bytes_arrows(void)
+{
+    _init_recording();
+    _ingest_string("abcdef");
+
+    // backspace char to the left, reprint the char to the right
+    TEST_ASSERT_EQUAL_size_t(1, _count_output("\x1B[D"));
+    TEST_ASSERT_EQUAL_UINT8(0x08, transcript[0]);
+    TEST_ASSERT_EQUAL_size_t(1, _count_output("\x1B[C"));
+    TEST_ASSERT_EQUAL_UINT8('f', transcript[0]);
+    TEST_ASSERT_EQUAL_size_t(1, _count_output("\x02"));
+    TEST_ASSERT_EQUAL_size_t(1, _count_output("\x06"));
+}
+
+void test_motion_bytes_home_end_near(void)
+{
+    _init_recording();
+    _ingest_string("abc\x1B[D\x1B[D");
+
+    TEST_ASSERT_EQUAL_size_t(1, _count_output("\x1B[1~"));
+    TEST_ASSERT_EQUAL_size_t(3, _count_output("\x1B[4~"));
+    TEST_ASSERT_EQUAL_MEMORY("abc", transcript, 3);
+}
+
+void test_motion_bytes_home_end_far(void)
+{
+    _init_recording();
+    _ingest_string("0123456789012345678901234567890123456789");
+
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("\x01"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[2G", transcript, 4);
+    TEST_ASSERT_EQUAL_size_t(5, _count_output("\x05"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[40C", transcript, 5);
+    // 8 backspaces, then home from the 32nd position
+    TEST_ASSERT_EQUAL_size_t(12, _count_output("\x1B[D\x1B[D\x1B[D\x1B[D\x1B[D"
+                                               "\x1B[D\x1B[D\x1B[D\x01"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[2G", transcript + 8, 4);
+}
+
+void test_motion_bytes_relative_move(void)
+{
+    _init_recording();
+    _ingest_string("0123456789012345678901234567890123456789");
+    _ingest_string("\x1B[1~\x1B[C\x1B[C\x1B[C\x1B[C\x1B[C\x1B[C\x1B[C\x1B[C");
+
+    // 8 columns back: ESC[8D is as short as ESC[2G, but relative
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("\x01"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[8D", transcript, 4);
+}
+
+void test_motion_bytes_insert_near_end(void)
+{
+    _init_recording();
+    _ingest_string("abcdef\x1B[D");
+
+    // erase, tail, two backspaces and the echo
+    TEST_ASSERT_EQUAL_size_t(8, _count_output("X"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[Kff\x08\x08X", transcript, 8);
+}
+
+void test_motion_three_digit_parameter(void)
+{
+    uint8_t line[MAX_STR_LEN];
+    memset(line, 'x', 105);
+    line[105] = '\0';
+    _init_recording();
+    _ingest_string(line);
+    _ingest_string("\x01");
+
+    TEST_ASSERT_EQUAL_size_t(6, _count_output("\x05"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[105C", transcript, 6);
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("\x01"));
+    TEST_ASSERT_EQUAL_size_t(5, _count_output("\x06\x06\x06\x06\x06"));
+    TEST_ASSERT_EQUAL_size_t(6, _count_output("\x05"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[100C", transcript, 6);
+}
+
+void test_motion_full_line_parameter(void)
+{
+    uint8_t line[MAX_STR_LEN];
+    char expected[16];
+    int expected_len;
+    memset(line, 'x', MAX_STR_LEN - 1);
+    line[MAX_STR_LEN - 1] = '\0';
+    _init_recording();
+    _ingest_string(line);
+
+    // the column numbers aren't limited by the 8-bit range in the wide mode
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("\x01"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[2G", transcript, 4);
+    expected_len = snprintf(expected, sizeof(expected), "\x1B[%dC",
+                            MAX_STR_LEN - 1);
+    TEST_ASSERT_EQUAL_size_t(expected_len, _count_output("\x05"));
+    TEST_ASSERT_EQUAL_MEMORY(expected, transcript, expected_len);
+}
+
+/* ICH/DCH mode must edit with fixed-length sequences */
+
+void test_ich_insert_middle(void)
+{
+    _init_recording();
+    UcTerm_SetInsertDeleteMode(&hucterm, 1);
+    _ingest_string("abcdef\x1B[D\x1B[D\x1B[D");
+
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("X"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[@X", transcript, 4);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("{abcXdef|}", transcript + 2, 10);
+}
+
+void test_dch_delete_middle(void)
+{
+    _init_recording();
+    UcTerm_SetInsertDeleteMode(&hucterm, 1);
+    _ingest_string("abcdef\x1B[D\x1B[D\x1B[D");
+
+    TEST_ASSERT_EQUAL_size_t(3, _count_output("\x1B[3~"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[P", transcript, 3);
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("\x08"));
+    TEST_ASSERT_EQUAL_MEMORY("\x08\x1B[P", transcript, 4);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("{abef|}", transcript + 2, 7);
+}
+
+void test_dch_ctrl_u(void)
+{
+    _init_recording();
+    UcTerm_SetInsertDeleteMode(&hucterm, 1);
+    _ingest_string("abcdefghijkl\x1B[D\x1B[D");
+
+    TEST_ASSERT_EQUAL_size_t(9, _count_output("\x15"));
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[2G\x1B[10P", transcript, 9);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("{kl|}", transcript + 2, 5);
+}
+
+void test_ich_dch_cost_independent_of_tail(void)
+{
+    uint8_t line[MAX_STR_LEN];
+    memset(line, 'x', 110);
+    line[110] = '\0';
+    _init_recording();
+    UcTerm_SetInsertDeleteMode(&hucterm, 1);
+    _ingest_string(line);
+    _ingest_string("\x01");
+
+    TEST_ASSERT_EQUAL_size_t(4, _count_output("y"));
+    TEST_ASSERT_EQUAL_size_t(3, _count_output("\x1B[3~"));
+
+    UcTerm_SetInsertDeleteMode(&hucterm, 0);
+    TEST_ASSERT_GREATER_THAN_size_t(110, _count_output("y"));
+}
+
+/* Deferred rendering must send only the final state */
+
+static const uint8_t burst_input[] =
+    "show status of the moter\x7F\x7F\x7Ftor\x01\x06\x06\x06\x06\x06"
+    "\x06\x06\x06\x06\x06\x06\x06\x06\x06\x06\x06\x06\x06 all\x05 now!"
+    "\x1B[D\x1B[D\x1B[D\x1B[D\x1B[D\x0B\x1B[1~X\x1B[3~";
+
+void test_deferred_rendering_final_screen(void)
+{
+    static uint8_t expected_screen[SCREEN_WIDTH + 1];
+    size_t expected_col;
+    size_t expected_len;
+    size_t len = sizeof(burst_input) - 1;
+
+    _init_recording();
+    UcTerm_ShowPrompt(&hucterm);
+    UcTerm_IngestBuffer(&hucterm, burst_input, len);
+    _emulate_terminal(transcript, transcript_len);
+    memcpy(expected_screen, screen, sizeof(screen));
+    expected_col = screen_col;
+    expected_len = transcript_len;
+
+    _init_recording();
+    UcTerm_SetDeferredRendering(&hucterm, 1);
+    UcTerm_ShowPrompt(&hucterm);
+    UcTerm_IngestBuffer(&hucterm, burst_input, len);
+    TEST_ASSERT_EQUAL_size_t(7, transcript_len); // prompt only
+    UcTerm_Flush(&hucterm);
+    _emulate_terminal(transcript, transcript_len);
+
+    TEST_ASSERT_EQUAL_STRING(">Xhow status of the all motor", expected_screen);
+    TEST_ASSERT_EQUAL_STRING(expected_screen, screen);
+    TEST_ASSERT_EQUAL_size_t(expected_col, screen_col);
+    TEST_ASSERT_LESS_THAN_size_t(expected_len / 4, transcript_len);
+}
+
+void test_deferred_rendering_incremental(void)
+{
+    _init_recording();
+    UcTerm_SetDeferredRendering(&hucterm, 1);
+    _ingest_string("abcdef");
+    UcTerm_Flush(&hucterm);
+    TEST_ASSERT_EQUAL_MEMORY("abcdef", transcript, 6);
+
+    // cursor-only moves collapse into one
+    TEST_ASSERT_EQUAL_size_t(0, _count_output("\x1B[D\x1B[D\x1B[D\x1B[D\x1B[D"
+                                              "\x1B[D\x1B[C"));
+    UcTerm_Flush(&hucterm);
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[5D", transcript, 4);
+
+    // only the changed tail is redrawn, with erase of the leftovers
+    _count_output("\x1B[4~\x7F\x7F");
+    UcTerm_Flush(&hucterm);
+    TEST_ASSERT_EQUAL_size_t(6, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY("bcd\x1B[K", transcript, 6);
+
+    // nothing to do
+    transcript_len = 0;
+    UcTerm_Flush(&hucterm);
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+}
+
+void test_deferred_rendering_before_execute(void)
+{
+    _init_recording();
+    UcTerm_SetDeferredRendering(&hucterm, 1);
+    _ingest_string("cmd\r");
+
+    TEST_ASSERT_EQUAL_MEMORY("cmd\r\n{cmd|}", transcript, 11);
+}
+
+void test_deferred_rendering_on_ring_drain(void)
+{
+    _init_recording();
+    UcTerm_SetOutputRing(&hucterm, out_ring, sizeof(out_ring));
+    UcTerm_SetDeferredRendering(&hucterm, 1);
+    _ingest_string("abc\x7F" "d");
+
+    _drain_ring(16);
+    TEST_ASSERT_EQUAL_size_t(3, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY("abd", transcript, 3);
+}
+
+/* Bracketed paste */
+
+static const uint8_t paste_input[] =
+    "ls \x1B[D\x1B[D\x1B[200~cat -n /var/log/\r\nmessages | grep [e]rr\x1B[201~"
+    "\x1B[4~ \x1B[200~| head\x1B[201~";
+
+void test_bracketed_paste_inserts_at_cursor(void)
+{
+    _init_recording();
+    UcTerm_ShowPrompt(&hucterm);
+    _ingest_string((uint8_t *)paste_input);
+    _emulate_terminal(transcript, transcript_len);
+
+    TEST_ASSERT_EQUAL_STRING(">lcat -n /var/log/messages | grep [e]rrs  | head", screen);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("\r\n{lcat|-n|/var/log/messages|", transcript, 29);
+}
+
+void test_bracketed_paste_buffer_matches_chars(void)
+{
+    static uint8_t expected[MAX_TRANSCRIPT_LEN];
+    static UcTerm_HandleTypeDef expected_state;
+    size_t len = sizeof(paste_input) - 1;
+
+    _init_recording();
+    UcTerm_ShowPrompt(&hucterm);
+    _ingest_string((uint8_t *)paste_input);
+    _emulate_terminal(transcript, transcript_len);
+    memcpy(expected, screen, sizeof(screen));
+    expected_state = hucterm;
+
+    _init_recording();
+    UcTerm_ShowPrompt(&hucterm);
+    UcTerm_IngestBuffer(&hucterm, paste_input, 20);
+    UcTerm_IngestBuffer(&hucterm, paste_input + 20, len - 20);
+    _emulate_terminal(transcript, transcript_len);
+
+    TEST_ASSERT_EQUAL_STRING(expected, screen);
+    TEST_ASSERT_EQUAL_MEMORY(expected_state.storage, hucterm.storage,
+                             UCTERM_STORAGE_SIZE);
+}
+
+void test_bracketed_paste_single_write(void)
+{
+    _init_recording();
+    _ingest_string("ab\x1B[D");
+    UcTerm_RegisterPrintBufCallback(&hucterm, &recordBuf);
+    frame_count = 0;
+    transcript_len = 0;
+    UcTerm_IngestBuffer(&hucterm, "\x1B[200~0123456789\x1B[201~", 22);
+
+    // the run with the tail, then back to the insertion end
+    TEST_ASSERT_EQUAL_size_t(1, frame_count);
+    TEST_ASSERT_EQUAL_size_t(12, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY("0123456789b\x08", transcript, 12);
+}
+
+void test_bracketed_paste_truncates_overflow(void)
+{
+    uint8_t line[2 * MAX_STR_LEN];
+    memset(line, 'x', sizeof(line));
+    _init_recording();
+    _ingest_string("\x1B[200~");
+    UcTerm_IngestBuffer(&hucterm, line, sizeof(line));
+    _ingest_string("\x1B[201~\r");
+
+    // no error, the line is executed as far as it fits:
+    // echo, newline, {argv[0]|}, prompt
+    TEST_ASSERT_EQUAL_size_t((MAX_STR_LEN - 1) + 2 + (MAX_STR_LEN - 1 + 3) + 7,
+                             transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY("\r\n{x", &transcript[MAX_STR_LEN - 1], 4);
+}
+
+/* End-of-line fast path */
+
+size_t print_calls = 0;
+
+void countChar(uint8_t c)
+{
+    print_calls++;
+    recordChar(c);
+}
+
+void countStr(const uint8_t *s)
+{
+    print_calls++;
+    recordStr(s);
+}
+
+void test_append_run_single_print(void)
+{
+    _init_recording();
+    UcTerm_RegisterPrintCharCallback(&hucterm, &countChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &countStr);
+    print_calls = 0;
+    UcTerm_IngestBuffer(&hucterm, "hello world", 11);
+
+    TEST_ASSERT_EQUAL_size_t(1, print_calls);
+    TEST_ASSERT_EQUAL_MEMORY("hello world", transcript, 11);
+    TEST_ASSERT_EQUAL_size_t(11, transcript_len);
+}
+
+void test_append_run_stops_at_control(void)
+{
+    _init_recording();
+    UcTerm_RegisterPrintCharCallback(&hucterm, &countChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &countStr);
+    print_calls = 0;
+    UcTerm_IngestBuffer(&hucterm, "abc\x08" "de", 6);
+    TEST_ASSERT_EQUAL_size_t(3, print_calls);
+    UcTerm_IngestBuffer(&hucterm, "\x01X", 2);
+
+    // the runs are echoed at once: "abc", backspace, "de"
+    TEST_ASSERT_EQUAL_MEMORY("abc\x08" "de", transcript, 6);
+    _emulate_terminal(transcript, transcript_len);
+    TEST_ASSERT_EQUAL_STRING("Xabde", screen);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("\r\n{Xabde|}", transcript, 10);
+}
+
+void test_control_keys_on_full_line(void)
+{
+    uint8_t line[MAX_STR_LEN];
+    memset(line, 'a', MAX_STR_LEN - 1);
+    line[MAX_STR_LEN - 1] = '\0';
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, line, MAX_STR_LEN - 1);
+    transcript_len = 0;
+
+    // cursor keys and unsupported control chars never reach the length check
+    UcTerm_IngestBuffer(&hucterm, "\x02\x02\x06\t\x07", 5);
+    TEST_ASSERT_EQUAL_size_t(3, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY("\x08\x08" "a", transcript, 3);
+
+    _count_output("\r");
+    TEST_ASSERT_EQUAL_MEMORY("\r\n{", transcript, 3);
+    TEST_ASSERT_EQUAL_MEMORY(line, &transcript[3], MAX_STR_LEN - 1);
+}
+
+void test_esc_home_end_variants(void)
+{
+    _init_recording();
+    _ingest_string("bc");
+    // xterm Home, SS3 Left, PuTTY End, VT Home, rxvt End
+    _ingest_string("\x1B[Ha\x1BOD\x1B[4~d\x1B[7~\x1BOC\x1B[8~e");
+    _ingest_string("\x1BOHX\x1B[FY\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "\r\n{XabcdeY|}"));
+}
+
+void test_esc_modifier_arrows(void)
+{
+    _init_recording();
+    _ingest_string("abc");
+    // Ctrl+Left, Shift+Left, Ctrl+Right
+    _ingest_string("\x1B[1;5D\x1B[1;2D\x1B[1;5CX\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "\r\n{abXc|}"));
+}
+
+void test_esc_unhandled_sequences_are_silent(void)
+{
+    _init_recording();
+    _ingest_string("ab");
+    transcript_len = 0;
+    // Up, PgUp, F1, DSR reply, DA reply, Alt+x, charset, overlong params
+    _ingest_string("\x1B[A\x1B[5~\x1BOP\x1B[12;40R\x1B[?1;2c"
+                   "\x1Bx\x1B(B\x1B[1;2;3;4;5;6;7;8;9;1234567890Z");
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+
+    _ingest_string("c\r");
+    TEST_ASSERT_EQUAL_MEMORY("c\r\n{abc|}", transcript, 9);
+}
+
+void test_esc_overlong_param_saturates(void)
+{
+    _init_recording();
+    _ingest_string("abc\x1B[H");
+    // 65540 would wrap to 4 (End) in 16 bits
+    _ingest_string("\x1B[65540~X\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "\r\n{Xabc|}"));
+}
+
+void test_esc_aborted_by_control_char(void)
+{
+    _init_recording();
+    _ingest_string("ab\x1B[1");
+    // Enter inside the sequence is processed as usual
+    _ingest_string("\r");
+    TEST_ASSERT_EQUAL_MEMORY("ab\r\n{ab|}", transcript, 9);
+}
+
+void test_tick_drops_lone_esc(void)
+{
+    _init_recording();
+    UcTerm_Tick(&hucterm, 1000);
+    _ingest_string("\x1B");
+    UcTerm_Tick(&hucterm, 1049);
+    UcTerm_Tick(&hucterm, 1050);
+    // not taken for Alt+a
+    _ingest_string("a\r");
+    TEST_ASSERT_EQUAL_MEMORY("a\r\n{a|}", transcript, 7);
+}
+
+void test_tick_ends_unterminated_paste(void)
+{
+    _init_recording();
+    UcTerm_Tick(&hucterm, 1000);
+    _ingest_string("\x1B[200~abc");
+    UcTerm_Tick(&hucterm, 1030);
+    // still pasting
+    _ingest_string("\r");
+    TEST_ASSERT_NULL(strstr(transcript, "{"));
+    // ESC[201~ is lost
+    UcTerm_Tick(&hucterm, 1079);
+    UcTerm_Tick(&hucterm, 1080);
+    _ingest_string("\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "{abc|}"));
+}
+
+void test_tick_keeps_sequence_within_timeout(void)
+{
+    _init_recording();
+    UcTerm_Tick(&hucterm, 0xFFFFFFF0u);
+    _ingest_string("ab\x1B[");
+    // the sequence is resumed in time, even across the time wrap
+    UcTerm_Tick(&hucterm, 0x10u);
+    _ingest_string("DX\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "\r\n{aXb|}"));
+}
+
+void test_tick_esc_timeout_disabled(void)
+{
+    _init_recording();
+    UcTerm_SetEscTimeout(&hucterm, 0);
+    UcTerm_Tick(&hucterm, 0);
+    _ingest_string("\x1B");
+    UcTerm_Tick(&hucterm, 60000);
+    _ingest_string("ab\r");
+    TEST_ASSERT_EQUAL_MEMORY("b\r\n{b|}", transcript, 7);
+}
+
+void test_tick_renders_on_idle(void)
+{
+    _init_recording();
+    UcTerm_SetDeferredRendering(&hucterm, 1);
+    UcTerm_Tick(&hucterm, 0);
+    _ingest_string("abc");
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+    // the input is still coming
+    UcTerm_Tick(&hucterm, 1);
+    TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+    UcTerm_Tick(&hucterm, 2);
+    TEST_ASSERT_EQUAL_MEMORY("abc", transcript, 3);
+    TEST_ASSERT_EQUAL_size_t(3, transcript_len);
+}
+
+/* Caller-supplied line buffer */
+
+static inline void _init_recording_with_buffer(uint8_t *line, size_t cap)
+{
+    _init_recording();
+    UcTerm_InitWithBuffer(&hucterm, line, cap);
+    UcTerm_RegisterPrintCharCallback(&hucterm, &recordChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &recordStr);
+    UcTerm_RegisterExecuteCallback(&hucterm, &recordExecute);
+}
+
+void test_init_with_buffer_uses_line(void)
+{
+    uint8_t line[8];
+    _init_recording_with_buffer(line, sizeof(line));
+    _ingest_string("abc\x02X");
+    TEST_ASSERT_EQUAL_STRING("abXc", line);
+
+    _ingest_string("\x05" "def\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "def\r\n{abXcdef|}"));
+}
+
+void test_init_with_buffer_limits_line(void)
+{
+    uint8_t line[8];
+    _init_recording_with_buffer(line, sizeof(line));
+    _ingest_string("abcdefg");
+    TEST_ASSERT_EQUAL_size_t(7, transcript_len);
+
+    // the 8th char doesn't fit
+    TEST_ASSERT_EQUAL_size_t(6, _count_output("h"));
+    TEST_ASSERT_EQUAL_MEMORY("\r\n?\r\n>", transcript, 6);
+}
+
+void test_init_with_buffer_truncates_paste(void)
+{
+    uint8_t line[6];
+    _init_recording_with_buffer(line, sizeof(line));
+    _ingest_string("ab\x1B[200~0123456789\x1B[201~\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "\r\n{ab012|}"));
+}
+
+void test_init_with_buffer_rejects_small_capacity(void)
+{
+    uint8_t line[2] = {'#', '#'};
+    for (size_t cap = 0; cap < 2; cap++)
+    {
+        _init_recording();
+        TEST_ASSERT_EQUAL_UINT8(0, UcTerm_InitWithBuffer(&hucterm, line, cap));
+        UcTerm_RegisterPrintCharCallback(&hucterm, &recordChar);
+        UcTerm_RegisterPrintStrCallback(&hucterm, &recordStr);
+        UcTerm_RegisterExecuteCallback(&hucterm, &recordExecute);
+        // nothing written to the line, the input is ignored
+        TEST_ASSERT_EQUAL_size_t(0, UcTerm_IngestBuffer(&hucterm, "ab\r", 3));
+        UcTerm_IngestChar(&hucterm, 'c');
+        TEST_ASSERT_EQUAL_MEMORY("##", line, 2);
+        TEST_ASSERT_EQUAL_size_t(0, transcript_len);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_InitWithBuffer(&hucterm, NULL, 8));
+
+    // a single char fits the smallest line
+    _init_recording();
+    TEST_ASSERT_EQUAL_UINT8(1, UcTerm_InitWithBuffer(&hucterm, line, 2));
+    UcTerm_RegisterPrintCharCallback(&hucterm, &recordChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &recordStr);
+    UcTerm_RegisterExecuteCallback(&hucterm, &recordExecute);
+    _ingest_string("a\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "{a|}"));
+}
+
+void test_init_with_buffer_cuts_capacity_to_index_range(void)
+{
+    // more than the indices reach: cut down to their range
+    static uint8_t line[(UcTerm_Index_t)~0u + 2];
+    _init_recording();
+    TEST_ASSERT_EQUAL_UINT8(1, UcTerm_InitWithBuffer(&hucterm, line,
+                                                     sizeof(line)));
+    UcTerm_RegisterPrintCharCallback(&hucterm, &recordChar);
+    UcTerm_RegisterPrintStrCallback(&hucterm, &recordStr);
+    UcTerm_RegisterExecuteCallback(&hucterm, &recordExecute);
+    // the cursor column stays within the range
+    for (size_t i = 0; i < (UcTerm_Index_t)~0u - UCTERM_PROMPT_WIDTH - 1; i++)
+    {
+        UcTerm_IngestChar(&hucterm, 'x');
+    }
+    TEST_ASSERT_EQUAL_size_t((UcTerm_Index_t)~0u - UCTERM_PROMPT_WIDTH - 1,
+                             strlen((const char *)line));
+    transcript_len = 0;
+    UcTerm_IngestChar(&hucterm, 'x');
+    TEST_ASSERT_EQUAL_MEMORY("\r\n?\r\n>", transcript, 6);
+}
+
+void test_init_with_buffer_instances_independent(void)
+{
+    static UcTerm_HandleTypeDef hsmall;
+    uint8_t small_line[4];
+    uint8_t line[16];
+    _init_recording_with_buffer(line, sizeof(line));
+    UcTerm_InitWithBuffer(&hsmall, small_line, sizeof(small_line));
+    UcTerm_RegisterPrintCharCallback(&hsmall, &recordChar);
+    UcTerm_RegisterPrintStrCallback(&hsmall, &recordStr);
+    UcTerm_RegisterExecuteCallback(&hsmall, &recordExecute);
+
+    UcTerm_IngestBuffer(&hsmall, "xyz", 3);
+    _ingest_string("0123456789");
+    TEST_ASSERT_EQUAL_STRING("xyz", small_line);
+    TEST_ASSERT_EQUAL_STRING("0123456789", line);
+}
+
+/* Shared callbacks table */
+
+typedef struct
+{
+    uint8_t out[MAX_TRANSCRIPT_LEN];
+    size_t out_len;
+    size_t frames;
+    uint8_t cmd[MAX_STR_LEN];
+} OpsSession_t;
+
+void opsChar(void *user, uint8_t c)
+{
+    OpsSession_t *session = (OpsSession_t *)user;
+    if (session->out_len < MAX_TRANSCRIPT_LEN)
+    {
+        session->out[session->out_len++] = c;
+    }
+}
+
+void opsStr(void *user, const uint8_t *s)
+{
+    while (*s != '\0')
+    {
+        opsChar(user, *(s++));
+    }
+}
+
+void opsBuf(void *user, const uint8_t *data, size_t len)
+{
+    ((OpsSession_t *)user)->frames++;
+    for (size_t i = 0; i < len; i++)
+    {
+        opsChar(user, data[i]);
+    }
+}
+
+void opsExecute(void *user, uint8_t ac, uint8_t *av[])
+{
+    OpsSession_t *session = (OpsSession_t *)user;
+    if (0 < ac)
+    {
+        strcpy_s(session->cmd, MAX_STR_LEN, av[0]);
+    }
+    // same record as recordExecute
+    opsChar(user, '{');
+    for (uint8_t i = 0; i < ac; i++)
+    {
+        opsStr(user, av[i]);
+        opsChar(user, '|');
+    }
+    opsChar(user, '}');
+}
+
+static const UcTerm_Ops ops_full = {
+    .printChr = &opsChar,
+    .printStr = &opsStr,
+    .exec = &opsExecute,
+};
+
+static const UcTerm_Ops ops_no_str = {
+    .printChr = &opsChar,
+    .exec = &opsExecute,
+};
+
+static const UcTerm_Ops ops_framed = {
+    .printChr = &opsChar,
+    .printBuf = &opsBuf,
+    .exec = &opsExecute,
+};
+
+static OpsSession_t session;
+
+static void _check_ops_output(const UcTerm_Ops *ops)
+{
+    size_t len = sizeof(differential_input) - 1;
+
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+
+    memset(&session, 0, sizeof(session));
+    UcTerm_Init(&hucterm);
+    UcTerm_SetOps(&hucterm, ops, &session);
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+
+    TEST_ASSERT_EQUAL_size_t(transcript_len, session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY(transcript, session.out, transcript_len);
+}
+
+void test_ops_matches_legacy_output(void)
+{
+    _check_ops_output(&ops_full);
+    TEST_ASSERT_EQUAL_size_t(0, session.frames);
+}
+
+void test_ops_print_str_optional(void)
+{
+    _check_ops_output(&ops_no_str);
+}
+
+void test_ops_print_buf_frames(void)
+{
+    _check_ops_output(&ops_framed);
+    TEST_ASSERT_NOT_EQUAL(0, session.frames);
+}
+
+void test_ops_shared_by_instances(void)
+{
+    static UcTerm_HandleTypeDef hsecond;
+    static OpsSession_t first;
+    static OpsSession_t second;
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+    UcTerm_Init(&hucterm);
+    UcTerm_Init(&hsecond);
+    UcTerm_SetOps(&hucterm, &ops_full, &first);
+    UcTerm_SetOps(&hsecond, &ops_full, &second);
+
+    UcTerm_IngestBuffer(&hucterm, "ab\n", 3);
+    UcTerm_IngestBuffer(&hsecond, "xyz\n", 4);
+
+    TEST_ASSERT_EQUAL_STRING("ab", first.cmd);
+    TEST_ASSERT_EQUAL_STRING("xyz", second.cmd);
+    TEST_ASSERT_EQUAL_MEMORY("ab", first.out, 2);
+    TEST_ASSERT_EQUAL_MEMORY("xyz", second.out, 3);
+}
+
+/* Static initialization */
+
+static UcTerm_HandleTypeDef hstatic =
+    UCTERM_STATIC_INITIALIZER(&ops_full, &session, hstatic);
+
+static uint8_t static_line[8];
+static UcTerm_HandleTypeDef hstatic_buf = UCTERM_STATIC_INITIALIZER_WITH_BUFFER(
+    &ops_full, &session, static_line, sizeof(static_line));
+
+void test_static_initializer_matches_init(void)
+{
+    size_t len = sizeof(differential_input) - 1;
+    _init_recording();
+    UcTerm_IngestBuffer(&hucterm, differential_input, len);
+
+    memset(&session, 0, sizeof(session));
+    UcTerm_IngestBuffer(&hstatic, differential_input, len);
+
+    TEST_ASSERT_EQUAL_size_t(transcript_len, session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY(transcript, session.out, transcript_len);
+}
+
+void test_static_initializer_with_buffer(void)
+{
+    memset(&session, 0, sizeof(session));
+    UcTerm_IngestBuffer(&hstatic_buf, "abcdefghij\r", 11);
+    // the 8th char doesn't fit the line buffer and drops the line
+    TEST_ASSERT_EQUAL_STRING("ij", session.cmd);
+}
+
+#if UCTERM_RESUME
+void test_resume_restores_line(void)
+{
+    memset(&session, 0, sizeof(session));
+    UcTerm_Init(&hucterm);
+    UcTerm_SetOps(&hucterm, &ops_full, &session);
+    UcTerm_SetEscTimeout(&hucterm, 20);
+    UcTerm_IngestBuffer(&hucterm, "abc\x1B[D\x1B[", 8);
+
+    // a warm reset keeps the storage
+    session.out_len = 0;
+    TEST_ASSERT_EQUAL_UINT8(1, UcTerm_Resume(&hucterm));
+    TEST_ASSERT_EQUAL_size_t(11, session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY("\x1B[0m\r\n>abc\x08", session.out, 11);
+
+    // the cut off sequence is dropped, the cursor position is kept
+    UcTerm_IngestBuffer(&hucterm, "X\r", 2);
+    TEST_ASSERT_EQUAL_STRING("abXc", session.cmd);
+}
+
+void test_resume_ends_paste(void)
+{
+    memset(&session, 0, sizeof(session));
+    UcTerm_Init(&hucterm);
+    UcTerm_SetOps(&hucterm, &ops_full, &session);
+    UcTerm_IngestBuffer(&hucterm, "\x1B[200~ab", 8);
+
+    // the reset cuts the paste off
+    TEST_ASSERT_EQUAL_UINT8(1, UcTerm_Resume(&hucterm));
+    UcTerm_IngestBuffer(&hucterm, "c\r", 2);
+    TEST_ASSERT_EQUAL_STRING("abc", session.cmd);
+}
+
+void test_resume_rejects_static_instance(void)
+{
+    // no checksum is computed at compile time
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_Resume(&hstatic));
+}
+
+void test_resume_rejects_invalid_storage(void)
+{
+    memset(&hucterm, 0, sizeof(hucterm));
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_Resume(&hucterm));
+    memset(&hucterm, 0xA5, sizeof(hucterm));
+    TEST_ASSERT_EQUAL_UINT8(0, UcTerm_Resume(&hucterm));
+}
+#endif
+
+/* Completion */
+
+static const char *const completion_words[] = {"help", "hello", "uname"};
+static uint8_t completion_arg_index;
+
+void opsComplete(void *user, UcTerm_Completion_t *completion)
+{
+    (void)user;
+    completion_arg_index = completion->arg_index;
+    for (size_t i = 0; i < sizeof(completion_words) / sizeof(completion_words[0]); i++)
+    {
+        if (!UcTerm_CompletionAdd(completion, (const uint8_t *)completion_words[i]))
+        {
+            return;
+        }
+    }
+}
+
+static const UcTerm_Ops ops_complete = {
+    .printChr = &opsChar,
+    .printStr = &opsStr,
+    .exec = &opsExecute,
+    .complete = &opsComplete,
+};
+
+static void _init_completion(const UcTerm_Ops *ops)
+{
+    memset(&session, 0, sizeof(session));
+    UcTerm_Init(&hucterm);
+    UcTerm_SetOps(&hucterm, ops, &session);
+}
+
+void test_tab_completes_unique_candidate(void)
+{
+    _init_completion(&ops_complete);
+    UcTerm_IngestBuffer(&hucterm, "un\t", 3);
+    // the rest of the name and a separator in one write
+    TEST_ASSERT_EQUAL_size_t(6, session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY("uname ", session.out, 6);
+    UcTerm_IngestBuffer(&hucterm, "-a\r", 3);
+    TEST_ASSERT_EQUAL_STRING("uname", session.cmd);
+    TEST_ASSERT_EQUAL_UINT8(0, completion_arg_index);
+}
+
+void test_tab_completes_in_frame(void)
+{
+    static const UcTerm_Ops ops_complete_framed = {
+        .printChr = &opsChar,
+        .printBuf = &opsBuf,
+        .exec = &opsExecute,
+        .complete = &opsComplete,
+    };
+    _init_completion(&ops_complete_framed);
+    UcTerm_IngestBuffer(&hucterm, "un\t\t", 4);
+    TEST_ASSERT_EQUAL_size_t(1, session.frames);
+    TEST_ASSERT_EQUAL_MEMORY("uname ", session.out, 6);
+}
+
+void test_tab_completes_common_prefix(void)
+{
+    _init_completion(&ops_complete);
+    UcTerm_IngestBuffer(&hucterm, "h\t", 2);
+    TEST_ASSERT_EQUAL_size_t(3, session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY("hel", session.out, 3);
+    // another key breaks the series, a single Tab with nothing
+    // to insert doesn't list
+    UcTerm_IngestBuffer(&hucterm, "x\x08", 2);
+    session.out_len = 0;
+    UcTerm_IngestBuffer(&hucterm, "\t", 1);
+    TEST_ASSERT_EQUAL_size_t(0, session.out_len);
+}
+
+void test_double_tab_lists_candidates(void)
+{
+    const char *expected = "hel\r\nhelp\thello\x1B[0m\r\n>hel";
+    _init_completion(&ops_complete);
+    UcTerm_IngestBuffer(&hucterm, "h\t\t", 3);
+    TEST_ASSERT_EQUAL_size_t(strlen(expected), session.out_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, session.out, session.out_len);
+    UcTerm_IngestBuffer(&hucterm, "p\r", 2);
+    TEST_ASSERT_EQUAL_STRING("help", session.cmd);
+}
+
+void test_tab_completes_argument_at_cursor(void)
+{
+    _init_completion(&ops_complete);
+    UcTerm_IngestBuffer(&hucterm, "x una\x1B[D\t\r", 10);
+    // the token is cut at the cursor
+    TEST_ASSERT_EQUAL_UINT8(1, completion_arg_index);
+    TEST_ASSERT_NOT_NULL(strstr((const char *)session.out, "{x|uname|a|}"));
+}
+
+static uint16_t completion_calls;
+
+void opsCompleteMany(void *user, UcTerm_Completion_t *completion)
+{
+    uint8_t word[6] = "r0000";
+    (void)user;
+    // generated on the fly, one at a time
+    for (uint16_t i = 0; i < 2000; i++)
+    {
+        word[1] = '0' + i / 1000;
+        word[2] = '0' + (i / 100) % 10;
+        word[3] = '0' + (i / 10) % 10;
+        word[4] = '0' + i % 10;
+        completion_calls++;
+        if (!UcTerm_CompletionAdd(completion, word))
+        {
+            return;
+        }
+    }
+}
+
+static const UcTerm_Ops ops_complete_many = {
+    .printChr = &opsChar,
+    .printStr = &opsStr,
+    .exec = &opsExecute,
+    .complete = &opsCompleteMany,
+};
+
+void test_completion_iteration_bounded(void)
+{
+    size_t tabs = 0;
+    _init_completion(&ops_complete_many);
+    completion_calls = 0;
+    UcTerm_IngestBuffer(&hucterm, "r0\t", 3);
+    // nothing to insert as soon as a word breaks the common part
+    TEST_ASSERT_EQUAL_size_t(2, session.out_len);
+    TEST_ASSERT_EQUAL_UINT16(101, completion_calls);
+
+    session.out_len = 0;
+    completion_calls = 0;
+    UcTerm_IngestBuffer(&hucterm, "\t", 1);
+    for (size_t i = 0; i < session.out_len; i++)
+    {
+        tabs += ('\t' == session.out[i]);
+    }
+    // the listing stops at the limit
+    TEST_ASSERT_EQUAL_size_t(UCTERM_MAX_COMPLETIONS, tabs);
+    TEST_ASSERT_NOT_NULL(strstr((const char *)session.out, "r0063\t...\x1B[0m"));
+    TEST_ASSERT_EQUAL_UINT16(101 + UCTERM_MAX_COMPLETIONS + 1, completion_calls);
+}
+
+void test_completion_listing_fits_ring(void)
+{
+    const char *redraw = "\t...\x1B[0m\r\n>r0";
+    size_t redraw_len = strlen(redraw);
+    _init_completion(&ops_complete_many);
+    UcTerm_SetOutputRing(&hucterm, out_ring, RING_HEADROOM + 24);
+    UcTerm_IngestBuffer(&hucterm, "r0\t\t", 4);
+    transcript_len = 0;
+    _drain_ring(16);
+    // the listing is cut short to keep the line redraw
+    TEST_ASSERT_LESS_THAN_size_t(RING_HEADROOM + 24, transcript_len);
+    TEST_ASSERT_GREATER_THAN_size_t(redraw_len, transcript_len);
+    TEST_ASSERT_EQUAL_MEMORY(redraw, &transcript[transcript_len - redraw_len],
+                             redraw_len);
+}
+
+void opsCompleteLong(void *user, UcTerm_Completion_t *completion)
+{
+    (void)user;
+    UcTerm_CompletionAdd(completion,
+                         (const uint8_t *)"abcdefghijklmnopqrstuvwxyz0123456789ABCD");
+}
+
+void test_tab_completes_long_word_in_steps(void)
+{
+    static const UcTerm_Ops ops_complete_long = {
+        .printChr = &opsChar,
+        .printStr = &opsStr,
+        .exec = &opsExecute,
+        .complete = &opsCompleteLong,
+    };
+    _init_completion(&ops_complete_long);
+    UcTerm_IngestBuffer(&hucterm, "a\t", 2);
+    // up to UCTERM_MAX_COMPLETION_LEN chars at once, no separator yet
+    TEST_ASSERT_EQUAL_size_t(1 + UCTERM_MAX_COMPLETION_LEN, session.out_len);
+    UcTerm_IngestBuffer(&hucterm, "\tx\r", 3);
+    TEST_ASSERT_EQUAL_STRING("abcdefghijklmnopqrstuvwxyz0123456789ABCD", session.cmd);
+    TEST_ASSERT_NOT_NULL(strstr((const char *)session.out, "ABCD x"));
+}
+
+void test_tab_ignored_without_completer(void)
+{
+    _init_completion(&ops_full);
+    UcTerm_IngestBuffer(&hucterm, "ab\tc\r", 5);
+    TEST_ASSERT_EQUAL_STRING("abc", session.cmd);
+    TEST_ASSERT_EQUAL_MEMORY("abc", session.out, 3);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -787,5 +2335,84 @@ int main(void)
     RUN_TEST(test_ctrl_k_last_pos);
     RUN_TEST(test_ctrl_k_first_pos);
     RUN_TEST(test_ctrl_k_middle_pos);
+    RUN_TEST(test_ingest_buffer_whole);
+    RUN_TEST(test_ingest_buffer_chunks);
+    RUN_TEST(test_ingest_buffer_empty);
+    RUN_TEST(test_print_buf_matches_char_output);
+#if UCTERM_MAX_FRAME_LEN > 0
+    RUN_TEST(test_print_buf_single_frame_per_event);
+    RUN_TEST(test_print_buf_single_frame_per_buffer);
+    RUN_TEST(test_print_buf_splits_at_mtu);
+#else
+    RUN_TEST(test_print_buf_without_frame);
+#endif
+    RUN_TEST(test_print_buf_flushes_before_execute);
+    RUN_TEST(test_output_ring_matches_char_output);
+    RUN_TEST(test_output_ring_ingest_buffer_stops_when_busy);
+    RUN_TEST(test_output_ring_busy);
+    RUN_TEST(test_output_ring_partial_read);
+    RUN_TEST(test_motion_bytes_arrows);
+    RUN_TEST(test_motion_bytes_home_end_near);
+    RUN_TEST(test_motion_bytes_home_end_far);
+    RUN_TEST(test_motion_bytes_relative_move);
+    RUN_TEST(test_motion_bytes_insert_near_end);
+    RUN_TEST(test_motion_three_digit_parameter);
+    RUN_TEST(test_motion_full_line_parameter);
+    RUN_TEST(test_ich_insert_middle);
+    RUN_TEST(test_dch_delete_middle);
+    RUN_TEST(test_dch_ctrl_u);
+    RUN_TEST(test_ich_dch_cost_independent_of_tail);
+    RUN_TEST(test_deferred_rendering_final_screen);
+    RUN_TEST(test_deferred_rendering_incremental);
+    RUN_TEST(test_deferred_rendering_before_execute);
+    RUN_TEST(test_deferred_rendering_on_ring_drain);
+    RUN_TEST(test_bracketed_paste_inserts_at_cursor);
+    RUN_TEST(test_bracketed_paste_buffer_matches_chars);
+#if UCTERM_MAX_FRAME_LEN > 0
+    RUN_TEST(test_bracketed_paste_single_write);
+#endif
+    RUN_TEST(test_bracketed_paste_truncates_overflow);
+    RUN_TEST(test_append_run_single_print);
+    RUN_TEST(test_append_run_stops_at_control);
+    RUN_TEST(test_control_keys_on_full_line);
+    RUN_TEST(test_init_with_buffer_uses_line);
+    RUN_TEST(test_init_with_buffer_limits_line);
+    RUN_TEST(test_init_with_buffer_truncates_paste);
+    RUN_TEST(test_init_with_buffer_rejects_small_capacity);
+    RUN_TEST(test_init_with_buffer_cuts_capacity_to_index_range);
+    RUN_TEST(test_init_with_buffer_instances_independent);
+    RUN_TEST(test_esc_home_end_variants);
+    RUN_TEST(test_esc_modifier_arrows);
+    RUN_TEST(test_esc_unhandled_sequences_are_silent);
+    RUN_TEST(test_esc_overlong_param_saturates);
+    RUN_TEST(test_esc_aborted_by_control_char);
+    RUN_TEST(test_tick_drops_lone_esc);
+    RUN_TEST(test_tick_ends_unterminated_paste);
+    RUN_TEST(test_tick_keeps_sequence_within_timeout);
+    RUN_TEST(test_tick_esc_timeout_disabled);
+    RUN_TEST(test_tick_renders_on_idle);
+    RUN_TEST(test_ops_matches_legacy_output);
+    RUN_TEST(test_ops_print_str_optional);
+    RUN_TEST(test_ops_print_buf_frames);
+    RUN_TEST(test_ops_shared_by_instances);
+    RUN_TEST(test_static_initializer_matches_init);
+    RUN_TEST(test_static_initializer_with_buffer);
+#if UCTERM_RESUME
+    RUN_TEST(test_resume_restores_line);
+    RUN_TEST(test_resume_ends_paste);
+    RUN_TEST(test_resume_rejects_static_instance);
+    RUN_TEST(test_resume_rejects_invalid_storage);
+#endif
+    RUN_TEST(test_tab_completes_unique_candidate);
+#if UCTERM_MAX_FRAME_LEN > 0
+    RUN_TEST(test_tab_completes_in_frame);
+#endif
+    RUN_TEST(test_tab_completes_common_prefix);
+    RUN_TEST(test_double_tab_lists_candidates);
+    RUN_TEST(test_tab_completes_argument_at_cursor);
+    RUN_TEST(test_tab_completes_long_word_in_steps);
+    RUN_TEST(test_tab_ignored_without_completer);
+    RUN_TEST(test_completion_iteration_bounded);
+    RUN_TEST(test_completion_listing_fits_ring);
     return UNITY_END();
 }
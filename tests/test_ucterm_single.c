@@ -0,0 +1,139 @@
+#include "./unity/unity.h"
+#include "../ucterm.h"
+#include <stdint.h>
+#include <string.h>
+
+// ucterm.c is built with UCTERM_SINGLE_INSTANCE and the hooks
+// of ucterm_single_config.h (unit_tests_single).
+
+static UcTerm_HandleTypeDef hucterm;
+
+/* Output recording - the hooks */
+
+#define MAX_TRANSCRIPT_LEN 512
+
+static char transcript[MAX_TRANSCRIPT_LEN + 1];
+static size_t transcript_len;
+
+void hookChar(uint8_t c)
+{
+    TEST_ASSERT_LESS_THAN_size_t(MAX_TRANSCRIPT_LEN, transcript_len);
+    transcript[transcript_len++] = (char)c;
+    transcript[transcript_len] = '\0';
+}
+
+static void _record_str(const char *s)
+{
+    while ('\0' != *s)
+    {
+        hookChar((uint8_t)*(s++));
+    }
+}
+
+void hookExecute(uint8_t ac, uint8_t **av)
+{
+    _record_str("{");
+    for (uint8_t i = 0; i < ac; i++)
+    {
+        _record_str((const char *)av[i]);
+        _record_str("|");
+    }
+    _record_str("}");
+}
+
+void hookComplete(void *completion)
+{
+    static const char *const words[] = {"help", "hello", "uname"};
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+    {
+        if (!UcTerm_CompletionAdd((UcTerm_Completion_t *)completion,
+                                  (const uint8_t *)words[i]))
+        {
+            return;
+        }
+    }
+}
+
+/* Callbacks that must not be called */
+
+static void failChar(void *user, uint8_t c)
+{
+    (void)user;
+    (void)c;
+    TEST_FAIL_MESSAGE("printChr called instead of the hook");
+}
+
+static void failExecute(void *user, uint8_t ac, uint8_t *av[])
+{
+    (void)user;
+    (void)ac;
+    (void)av;
+    TEST_FAIL_MESSAGE("exec called instead of the hook");
+}
+
+static void _ingest_string(UcTerm_HandleTypeDef *self, const char *s)
+{
+    UcTerm_IngestBuffer(self, (const uint8_t *)s, strlen(s));
+}
+
+void setUp(void)
+{
+    transcript_len = 0;
+    transcript[0] = '\0';
+    UcTerm_Init(&hucterm);
+}
+
+void tearDown(void)
+{
+}
+
+void test_handle_is_placeholder(void)
+{
+    TEST_ASSERT_EQUAL_size_t(1, sizeof(UcTerm_HandleTypeDef));
+}
+
+void test_echo_and_execute_through_hooks(void)
+{
+    _ingest_string(&hucterm, "ab c\r");
+    // the strings go through the char hook
+    TEST_ASSERT_EQUAL_STRING("ab c\r\n{ab|c|}\x1B[0m\r\n>", transcript);
+}
+
+void test_handles_share_the_state(void)
+{
+    static UcTerm_HandleTypeDef hother;
+    _ingest_string(&hucterm, "xy");
+    _ingest_string(&hother, "z\r");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "{xyz|}"));
+}
+
+void test_callbacks_replaced_by_hooks(void)
+{
+    static const UcTerm_Ops ops_fail = {
+        .printChr = &failChar,
+        .exec = &failExecute,
+    };
+    UcTerm_SetOps(&hucterm, &ops_fail, NULL);
+    _ingest_string(&hucterm, "a\r");
+    TEST_ASSERT_EQUAL_STRING("a\r\n{a|}\x1B[0m\r\n>", transcript);
+}
+
+void test_tab_completes_through_hook(void)
+{
+    _ingest_string(&hucterm, "un\t");
+    TEST_ASSERT_EQUAL_STRING("uname ", transcript);
+    transcript_len = 0;
+    _ingest_string(&hucterm, "h\t\t");
+    TEST_ASSERT_NOT_NULL(strstr(transcript, "help\thello"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_handle_is_placeholder);
+    RUN_TEST(test_echo_and_execute_through_hooks);
+    RUN_TEST(test_handles_share_the_state);
+    RUN_TEST(test_callbacks_replaced_by_hooks);
+    RUN_TEST(test_tab_completes_through_hook);
+    return UNITY_END();
+}
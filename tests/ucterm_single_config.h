@@ -0,0 +1,20 @@
+/*
+Configuration of test_ucterm_single.c: the only instance
+with the output, exec and completion hooks bound at compile time.
+*/
+
+#ifndef UCTERM_SINGLE_CONFIG_H_
+#define UCTERM_SINGLE_CONFIG_H_
+
+#include <stdint.h>
+
+void hookChar(uint8_t c);
+void hookExecute(uint8_t argc, uint8_t **argv);
+void hookComplete(void *completion);
+
+#define UCTERM_SINGLE_INSTANCE 1
+#define UCTERM_HOOK_PRINT_CHAR(c) hookChar(c)
+#define UCTERM_HOOK_EXEC(argc, argv) hookExecute(argc, argv)
+#define UCTERM_HOOK_COMPLETE(completion) hookComplete(completion)
+
+#endif // UCTERM_SINGLE_CONFIG_H_
@@ -0,0 +1,200 @@
+#include "cli_phash_build.h"
+#include "../cli_hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Seeds tried per bucket before the table grows.
+#define MAX_SEED 255
+
+/* Private function prototypes */
+
+// Try to place the names with the current bucket and slot counts.
+static int _place(CliPhash_t *self, const uint32_t *hashes, size_t count,
+                  size_t *order, uint16_t *bucket_of);
+
+// Place one bucket, its names are order[first..last).
+static int _place_bucket(CliPhash_t *self, const uint32_t *hashes,
+                         const size_t *order, size_t first, size_t last);
+
+// Round up to a power of 2.
+static uint16_t _pow2(size_t n);
+
+/* Public interface implementation */
+
+int CliPhash_Build(CliPhash_t *self, const char *const *names, size_t count)
+{
+    uint32_t *hashes;
+    size_t *order;
+    uint16_t *bucket_of;
+    int result = -1;
+    memset(self, 0, sizeof(*self));
+    if (32768 < count)
+    {
+        return -1;
+    }
+    hashes = malloc((count + 1) * sizeof(*hashes));
+    order = malloc((count + 1) * sizeof(*order));
+    bucket_of = malloc((count + 1) * sizeof(*bucket_of));
+    if (NULL == hashes || NULL == order || NULL == bucket_of)
+    {
+        goto done;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        hashes[i] = CliHash_Name((const uint8_t *)names[i]);
+        // equal hashes can't be told apart by any seed
+        for (size_t j = 0; j < i; j++)
+        {
+            if (hashes[i] == hashes[j])
+            {
+                goto done;
+            }
+        }
+    }
+    // about 4 names per bucket at first, then fewer names per bucket
+    // and at last more slots per name until every bucket finds a seed
+    self->slot_count = _pow2(count);
+    self->bucket_count = _pow2((count + 3) / 4);
+    for (;;)
+    {
+        free(self->seeds);
+        free(self->slots);
+        self->seeds = calloc(self->bucket_count, sizeof(*self->seeds));
+        self->slots = calloc(self->slot_count, sizeof(*self->slots));
+        if (NULL == self->seeds || NULL == self->slots)
+        {
+            goto done;
+        }
+        if (0 == _place(self, hashes, count, order, bucket_of))
+        {
+            result = 0;
+            goto done;
+        }
+        if (self->bucket_count < self->slot_count)
+        {
+            self->bucket_count *= 2;
+        }
+        else if (self->slot_count < 32768)
+        {
+            self->slot_count *= 2;
+        }
+        else
+        {
+            goto done;
+        }
+    }
+done:
+    free(hashes);
+    free(order);
+    free(bucket_of);
+    if (0 != result)
+    {
+        CliPhash_Free(self);
+    }
+    return result;
+}
+
+void CliPhash_Free(CliPhash_t *self)
+{
+    free(self->seeds);
+    free(self->slots);
+    memset(self, 0, sizeof(*self));
+}
+
+/* Private functions implementation */
+
+static int _place(CliPhash_t *self, const uint32_t *hashes, size_t count,
+                  size_t *order, uint16_t *bucket_of)
+{
+    uint16_t bucket_mask = self->bucket_count - 1;
+    uint16_t *sizes = calloc(self->bucket_count, sizeof(*sizes));
+    uint16_t max_size = 0;
+    size_t ordered = 0;
+    int result = 0;
+    if (NULL == sizes)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        bucket_of[i] = (uint16_t)(CliHash_Mix(hashes[i], 0) & bucket_mask);
+        if (max_size < ++sizes[bucket_of[i]])
+        {
+            max_size = sizes[bucket_of[i]];
+        }
+    }
+    // the largest buckets go first, while most of the slots are free
+    for (uint16_t size = max_size; 0 < size && 0 == result; size--)
+    {
+        for (uint16_t bucket = 0; bucket < self->bucket_count; bucket++)
+        {
+            size_t first = ordered;
+            if (size != sizes[bucket])
+            {
+                continue;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                if (bucket == bucket_of[i])
+                {
+                    order[ordered++] = i;
+                }
+            }
+            result = _place_bucket(self, hashes, order, first, ordered);
+            if (0 != result)
+            {
+                break;
+            }
+        }
+    }
+    free(sizes);
+    return result;
+}
+
+static int _place_bucket(CliPhash_t *self, const uint32_t *hashes,
+                         const size_t *order, size_t first, size_t last)
+{
+    uint16_t bucket_mask = self->bucket_count - 1;
+    uint16_t slot_mask = self->slot_count - 1;
+    uint16_t bucket = (uint16_t)(CliHash_Mix(hashes[order[first]], 0) &
+                                 bucket_mask);
+    for (uint32_t seed = 0; seed < MAX_SEED; seed++)
+    {
+        size_t placed = first;
+        for (; placed < last; placed++)
+        {
+            uint16_t slot = (uint16_t)(CliHash_Mix(hashes[order[placed]],
+                                                   seed + 1) &
+                                       slot_mask);
+            if (0 != self->slots[slot])
+            {
+                break;
+            }
+            self->slots[slot] = (uint16_t)(order[placed] + 1);
+        }
+        if (placed == last)
+        {
+            self->seeds[bucket] = (uint8_t)seed;
+            return 0;
+        }
+        // free the slots taken with this seed
+        for (size_t i = first; i < placed; i++)
+        {
+            uint16_t slot = (uint16_t)(CliHash_Mix(hashes[order[i]],
+                                                   seed + 1) &
+                                       slot_mask);
+            self->slots[slot] = 0;
+        }
+    }
+    return -1;
+}
+
+static uint16_t _pow2(size_t n)
+{
+    uint16_t pow2 = 1;
+    while (pow2 < n)
+    {
+        pow2 *= 2;
+    }
+    return pow2;
+}
@@ -0,0 +1,39 @@
+/*
+Perfect hash table builder for the CLI command names (host only).
+
+Hash and displace: the names are split into buckets, and each bucket
+gets a seed which sends all its names to free slots. Looked up with
+CliHash_Slot (see cli_hash.h). Used by cli_phashgen at build time
+and by the dispatch benchmark. The table is perfect but not minimal:
+the slot count is rounded up to a power of 2 (some slots stay free),
+so a slot is picked with a mask instead of a division.
+*/
+
+#ifndef CLI_PHASH_BUILD_H_
+#define CLI_PHASH_BUILD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Perfect hash table of the command names.
+typedef struct
+{
+    uint16_t bucket_count; // power of 2
+    uint16_t slot_count;   // power of 2, not less than the name count
+    uint8_t *seeds;        // seed of each bucket
+    uint16_t *slots;       // command index + 1 of each slot, 0 if free
+} CliPhash_t;
+
+/// @brief Build the table for the names.
+/// @param self     Table to fill, release it with CliPhash_Free.
+/// @param names    Command names.
+/// @param count    Name count (up to 32768).
+/// @return 0 on success, -1 if the names have a duplicate
+/// (or a hash collision) or the memory is exhausted.
+int CliPhash_Build(CliPhash_t *self, const char *const *names, size_t count);
+
+/// @brief Release the table memory.
+/// @param self     Table filled with CliPhash_Build.
+void CliPhash_Free(CliPhash_t *self);
+
+#endif // CLI_PHASH_BUILD_H_
@@ -0,0 +1,104 @@
+/*
+Build-time generator of the CLI command lookup table.
+
+Compiled with the command list (cli_commands.def) and run by the build
+(see CMakeLists.txt) to write cli_commands_phash.h, the lookup tables
+used by cli.c: the perfect hash table of the names and the command
+indices in name order (for the prefix matching). Without CMake, build and run it on the host
+after every change of the command list:
+
+    cc -I. tools/cli_phashgen.c tools/cli_phash_build.c -o cli_phashgen
+    ./cli_phashgen cli_commands_phash.h
+*/
+
+#include "cli_phash_build.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The command list of cli.c (the build of the tests names another one)
+#ifndef CLI_COMMANDS_FILE
+#define CLI_COMMANDS_FILE "../cli_commands.def"
+#endif
+
+// Only the names are needed here
+#define CLI_COMMAND_DEF(name, handler, help) name,
+#define CLI_COMMAND_DEF_COMPLETE(name, handler, help, complete) name,
+static const char *const _names[] = {
+#include CLI_COMMANDS_FILE
+};
+#undef CLI_COMMAND_DEF
+#undef CLI_COMMAND_DEF_COMPLETE
+
+#define NAME_COUNT (sizeof(_names) / sizeof(_names[0]))
+
+// Order the command indices by name (bytewise, like strcmp in cli.c).
+static int _compare_names(const void *a, const void *b)
+{
+    return strcmp(_names[*(const uint16_t *)a], _names[*(const uint16_t *)b]);
+}
+
+int main(int argc, char *argv[])
+{
+    CliPhash_t table;
+    uint16_t sorted[NAME_COUNT];
+    FILE *out;
+    if (2 != argc)
+    {
+        fprintf(stderr, "usage: %s <output header>\n", argv[0]);
+        return 1;
+    }
+    if (0 != CliPhash_Build(&table, _names, NAME_COUNT))
+    {
+        fprintf(stderr, "cli_phashgen: duplicate command names "
+                        "(or a hash collision) in cli_commands.def\n");
+        return 1;
+    }
+    out = fopen(argv[1], "w");
+    if (NULL == out)
+    {
+        perror(argv[1]);
+        CliPhash_Free(&table);
+        return 1;
+    }
+    fprintf(out, "// Generated by cli_phashgen from cli_commands.def"
+                 " - do not edit.\n\n");
+    fprintf(out, "#define CLI_HASH_COUNT %u\n", (unsigned)NAME_COUNT);
+    fprintf(out, "#define CLI_HASH_BUCKET_MASK 0x%04Xu\n",
+            (unsigned)(table.bucket_count - 1));
+    fprintf(out, "#define CLI_HASH_SLOT_MASK 0x%04Xu\n\n",
+            (unsigned)(table.slot_count - 1));
+    fprintf(out, "static CLI_FLASH_CONST uint8_t _cli_hash_seeds[%u] = {",
+            (unsigned)table.bucket_count);
+    for (uint16_t i = 0; i < table.bucket_count; i++)
+    {
+        fprintf(out, "%s%u,", (0 == i % 16) ? "\n    " : " ",
+                (unsigned)table.seeds[i]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "// command index + 1, 0 if free\n");
+    fprintf(out, "static CLI_FLASH_CONST uint16_t _cli_hash_slots[%u] = {",
+            (unsigned)table.slot_count);
+    for (uint16_t i = 0; i < table.slot_count; i++)
+    {
+        fprintf(out, "%s%u,", (0 == i % 16) ? "\n    " : " ",
+                (unsigned)table.slots[i]);
+    }
+    fprintf(out, "\n};\n\n");
+    for (uint16_t i = 0; i < NAME_COUNT; i++)
+    {
+        sorted[i] = i;
+    }
+    qsort(sorted, NAME_COUNT, sizeof(sorted[0]), _compare_names);
+    fprintf(out, "// command indices in name order\n");
+    fprintf(out, "static CLI_FLASH_CONST uint16_t _cli_sorted[%u] = {",
+            (unsigned)NAME_COUNT);
+    for (uint16_t i = 0; i < NAME_COUNT; i++)
+    {
+        fprintf(out, "%s%u,", (0 == i % 16) ? "\n    " : " ",
+                (unsigned)sorted[i]);
+    }
+    fprintf(out, "\n};\n");
+    CliPhash_Free(&table);
+    return (0 == fclose(out)) ? 0 : 1;
+}
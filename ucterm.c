@@ -1,28 +1,102 @@
 #include "ucterm.h"
 #include <string.h>
 
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+// keep the lookup tables in flash
+#define FLASH_CONST              const PROGMEM
+#define READ_FLASH_BYTE(address) pgm_read_byte(address)
+#else
+#define FLASH_CONST              const
+#define READ_FLASH_BYTE(address) (*(address))
+#endif
+
 /* Output strings to be printed */
 #define OUT_NEWLINE_STR ((uint8_t *)"\r\n")
-#define OUT_UNKNOWN_STR ((uint8_t *)"\r\n?\r\n>")
-#define OUT_PROMPT_STR  ((uint8_t *)"\x1B[0m\r\n>")
-// Note: the prompt char is '>' and you may use another.
-// Keep in mind that the prompt width of the OUT_PROMPT_STR is one visible char.
-// If you increase this, you also need to make corrections to
-// PROMPT_WIDTH and OUT_CHA_2.
+#define OUT_UNKNOWN_STR ((uint8_t *)"\r\n?\r\n" UCTERM_PROMPT)
+#define OUT_PROMPT_STR  ((uint8_t *)"\x1B[0m\r\n" UCTERM_PROMPT)
+#define OUT_MORE_STR    ((uint8_t *)"\t...")
+#define OUT_TAB_STR     ((uint8_t *)"\t")
+// Note: the prompt is configured with UCTERM_PROMPT (see ucterm_config.h),
+// keep UCTERM_PROMPT_WIDTH equal to its visible width.
 
 // how many visible characters does the cli prompt contain
-#define PROMPT_WIDTH  1
+#define PROMPT_WIDTH  UCTERM_PROMPT_WIDTH
 
 /* Terminal interaction commands */
-#define OUT_CHA_2     ((uint8_t *)"\x1B[2G") // move cursor to the 2nd column
-#define OUT_L_ARROW   ((uint8_t *)"\x1B[D")
-#define OUT_R_ARROW   ((uint8_t *)"\x1B[C")
 #define OUT_ERASE_END ((uint8_t *)"\x1B[K")
+#define OUT_BACKSPACE 0x08 // move cursor one column left
+#define OUT_INSERT_CHAR ((uint8_t *)"\x1B[@") // ICH: insert a blank at cursor
+
+/* Terminal command final bytes */
+#define CSI_CUB 'D' // cursor backward by n columns
+#define CSI_CUF 'C' // cursor forward by n columns
+#define CSI_CHA 'G' // cursor to the n-th column
+#define CSI_DCH 'P' // delete n chars at cursor, shifting the rest left
+
+// Maximum length of a generated ESC-sequence
+// with a numeric parameter (ESC [ n n n final \0).
+#if UCTERM_INDEX_BITS > 8
+#define MAX_CSI_LEN 9 // up to 5 digits
+#else
+#define MAX_CSI_LEN 7
+#endif
 
 /* ESC-sequence characters */
 #define ESC_HEADER    0x1B
 #define ESC_SEPRTR    '['
 
+#define IS_PRINTABLE(c) (0x20 <= (c) && 0x7E >= (c))
+
+/* Input byte classes (see _byte_class) */
+#define CLASS_OTHER      0 // ignored
+#define CLASS_PRINTABLE  1 // stored and echoed
+#define CLASS_ESC        2 // ESC-sequence start
+#define CLASS_ENTER      3 // CR, LF
+#define CLASS_BACKSPACE  4 // Backspace, DEL
+#define CLASS_HOME       5 // Ctrl+A
+#define CLASS_END        6 // Ctrl+E
+#define CLASS_LEFT       7 // Ctrl+B
+#define CLASS_RIGHT      8 // Ctrl+F
+#define CLASS_KILL_START 9 // Ctrl+U
+#define CLASS_KILL_END   10 // Ctrl+K
+#define CLASS_TAB        11 // Tab, completion
+
+/* ESC-sequence parser states (ECMA-48) */
+#define ESC_GROUND     0 // no sequence in progress
+#define ESC_ESCAPE     1 // ESC received
+#define ESC_ESC_INTER  2 // ESC and intermediate bytes received
+#define ESC_CSI        3 // ESC[ and parameter bytes received
+#define ESC_CSI_IGNORE 4 // malformed or unsupported CSI, wait for the final byte
+#define ESC_SS3        5 // ESC O received
+#define ESC_STATES     6
+
+/* ESC-sequence byte classes (see _esc_class) */
+#define ECLASS_C0      0  // C0 control (except the ones below)
+#define ECLASS_CANCEL  1  // CAN, SUB
+#define ECLASS_ESC     2  // ESC
+#define ECLASS_INTER   3  // intermediate 0x20-0x2F
+#define ECLASS_DIGIT   4  // parameter digit 0x30-0x39
+#define ECLASS_SEPRTR  5  // parameter separator ';'
+#define ECLASS_PRIVATE 6  // ':' and private markers 0x3C-0x3F
+#define ECLASS_CSI     7  // '[' (final byte of ESC, CSI introducer)
+#define ECLASS_SS3     8  // 'O' (final byte of ESC, SS3 introducer)
+#define ECLASS_FINAL   9  // other final bytes 0x40-0x7E
+#define ECLASS_DEL     10 // DEL, ignored inside a sequence
+#define ECLASS_HIGH    11 // 0x80-0xFF
+#define ECLASS_COUNT   12
+
+/* ESC-sequence parser actions (see _esc_transition) */
+#define EACT_NONE     0 // consume the byte
+#define EACT_PASS     1 // abort the sequence, process the byte as usual
+#define EACT_CLEAR    2 // clear the parameters
+#define EACT_PARAM    3 // accumulate a parameter digit
+#define EACT_NEXT     4 // start the next parameter
+#define EACT_DISPATCH 5 // the sequence is complete, execute it
+
+// Pack the parser transition into a byte.
+#define ESC_TRANSITION(state, action) (uint8_t)(((state) << 4) | (action))
+
 /* Special characters */
 #define KEY_ENTER_LF  '\n'
 #define KEY_ENTER_CR  '\r'
@@ -42,35 +116,141 @@
 
 /* State storage */
 
-// Maximum input line length
-// (one byte is always reserved for termination).
-#define MAX_STR_LEN 120
+// Sizes are configured in ucterm_config.h
+#define MAX_STR_LEN    UCTERM_MAX_STR_LEN
+#define MAX_ESC_PARAMS UCTERM_MAX_ESC_PARAMS
+#define MAX_ARG_COUNT  UCTERM_MAX_ARG_COUNT
+#define MAX_FRAME_LEN  UCTERM_MAX_FRAME_LEN
+#define MAX_COMPLETION_LEN UCTERM_MAX_COMPLETION_LEN
+
+// Numeric ESC-sequence parameters saturate at this value.
+#define MAX_ESC_PARAM_VALUE 9999
+
+/* Mode flags */
+#define FLAG_ICH_DCH  0x01 // edit with ICH/DCH instead of line redraw
+#define FLAG_DEFERRED 0x02 // postpone the line rendering until flush
+#define FLAG_PASTE    0x04 // inside a bracketed paste
+#define FLAG_INPUT    0x08 // input received since the last tick
+#define FLAG_FRAMED   0x10 // output through the PrintBuf callback
+#define FLAG_TAB      0x20 // the last key was an ambiguous Tab
+
+// Flags set only through the public setters (covered by the checksum).
+#define FLAG_SETTINGS (FLAG_ICH_DCH | FLAG_DEFERRED | FLAG_FRAMED)
 
-// Maximum ESC code length
-// (without the ESC symbol itself).
-#define MAX_ESC_LEN 4
+// The largest value of the index type.
+#define INDEX_MAX ((UcTerm_Index_t)~0u)
 
-// Maximum number of cli arguments
-// (including the command itself).
-#define MAX_ARG_COUNT 4
+// Dirty index value of the line with nothing to redraw.
+#define NOT_DIRTY INDEX_MAX
 
+// Output ring free space required to accept the next input char:
+// the longest output of a single input event (a whole line redraw).
+// The completion listing is cut short to keep it (see LIST_RESERVE).
+#define RING_HEADROOM(self) ((size_t)(self)->buf_size + 16)
+
+// Output ring space kept by the completion listing beside the candidate
+// and the line redraw: the separator and OUT_MORE_STR.
+#define LIST_RESERVE 6
+
+// The fields touched on every input byte come first, so they are
+// reachable with short displacements from the state pointer
+// (below 64 bytes on AVR, 32 bytes for the byte loads on Cortex-M0),
+// the cold fields and the arrays follow.
+// Keep UcTerm_StateLayout_t in ucterm.h in sync.
 typedef struct
 {
-  uint8_t *argv[MAX_ARG_COUNT]; // pointers to arguments
+  /* hot */
+  UcTerm_Index_t index;         // input buffer write index
+  UcTerm_Index_t length;        // length of the input buffer w/o terminator
+  UcTerm_Index_t buf_size;      // input buffer capacity
+  UcTerm_Index_t dirty_from;    // first input buffer index to redraw
+  UcTerm_Index_t term_index;    // terminal cursor position (deferred mode)
+  UcTerm_Index_t term_length;   // line length on the terminal (deferred mode)
+  uint8_t flags;                // mode and state flags
+  uint8_t esc_state;            // ESC-sequence parser state
+  uint8_t frame_len;            // count of bytes in the output frame
+  uint8_t frame_mtu;            // output frame flush threshold
+  uint8_t esc_param_index;      // ESC-sequence parameter being parsed
+  uint8_t *buf;                 // input characters buffer (line or external)
+  uint8_t *ring;                // output ring buffer (caller-allocated)
+  const UcTerm_Ops *ops;        // shared callbacks (NULL for the legacy ones)
+  void *user;                   // callbacks context
+#if UCTERM_LEGACY_CALLBACKS
   void (*printChr)(uint8_t);
   void (*printStr)(const uint8_t *);
+  void (*printBuf)(const uint8_t *, size_t);
   void (*exec)(uint8_t, uint8_t **);
-  uint8_t buf[MAX_STR_LEN];     // input characters buffer
-  uint8_t esc_buf[MAX_ESC_LEN]; // ESC-sequence buffer
-  uint8_t esc_index;            // ESC-sequence buffer write index
-  uint8_t index;                // input buffer write index
-  uint8_t length;               // length of the input buffer w/o terminator
-  uint8_t argc;                 // count of parsed arguments
-
+#endif
+  size_t ring_size;             // output ring capacity
+  size_t ring_head;             // output ring write index
+  size_t ring_tail;             // output ring read index
+  /* cold */
+  uint32_t now_ms;              // time of the last tick
+  uint32_t esc_time_ms;         // time of the last ESC-sequence or paste input
+  uint16_t esc_params[MAX_ESC_PARAMS]; // ESC-sequence numeric parameters
+  uint16_t esc_timeout_ms;      // incomplete ESC-sequence lifetime
+#if UCTERM_RESUME
+  uint16_t checksum;            // settings checksum for UcTerm_Resume
+#endif
+#if MAX_FRAME_LEN > 0
+  uint8_t frame[MAX_FRAME_LEN]; // output frame buffer (PrintBuf mode)
+#endif
+#if MAX_STR_LEN > 0
+  uint8_t line[MAX_STR_LEN];    // built-in input characters buffer
+#endif
 } UcTermState_t;
 
-_Static_assert(sizeof(UcTermState_t) <= UCTERM_STORAGE_SIZE,
-               "UCTERM_STORAGE_SIZE too small");
+_Static_assert(sizeof(UcTermState_t) == UCTERM_STORAGE_SIZE,
+               "UcTerm_StateLayout_t doesn't match UcTermState_t");
+#if !UCTERM_SINGLE_INSTANCE
+#if MAX_STR_LEN > 0
+_Static_assert(offsetof(UcTermState_t, line) == UCTERM_LINE_OFFSET_,
+               "UCTERM_LINE_OFFSET_ doesn't match UcTermState_t");
+#endif
+_Static_assert(FLAG_ICH_DCH == UCTERM_FLAG_ICH_DCH_,
+               "UCTERM_FLAG_ICH_DCH_ doesn't match FLAG_ICH_DCH");
+
+// Every field set by UCTERM_STATIC_INITIALIZER_WITH_BUFFER must be
+// at the place of its UcTerm_StateLayout_t array element.
+#define LAYOUT_MATCHES(field, array, i)                  \
+  (offsetof(UcTermState_t, field) ==                     \
+   offsetof(UcTerm_StateLayout_t, array) +               \
+       (i) * sizeof(((UcTerm_StateLayout_t *)0)->array[0]))
+_Static_assert(LAYOUT_MATCHES(index, _indices, 0) &&
+                   LAYOUT_MATCHES(length, _indices, 1) &&
+                   LAYOUT_MATCHES(buf_size, _indices, 2) &&
+                   LAYOUT_MATCHES(dirty_from, _indices, 3) &&
+                   LAYOUT_MATCHES(term_index, _indices, 4) &&
+                   LAYOUT_MATCHES(term_length, _indices, 5),
+               "UcTerm_StateLayout_t._indices doesn't match UcTermState_t");
+_Static_assert(LAYOUT_MATCHES(flags, _flags, 0) &&
+                   LAYOUT_MATCHES(esc_state, _flags, 1) &&
+                   LAYOUT_MATCHES(frame_len, _flags, 2) &&
+                   LAYOUT_MATCHES(frame_mtu, _flags, 3) &&
+                   LAYOUT_MATCHES(esc_param_index, _flags, 4),
+               "UcTerm_StateLayout_t._flags doesn't match UcTermState_t");
+_Static_assert(LAYOUT_MATCHES(buf, _pointers, 0) &&
+                   LAYOUT_MATCHES(ring, _pointers, 1) &&
+                   LAYOUT_MATCHES(ops, _pointers, 2) &&
+                   LAYOUT_MATCHES(user, _pointers, 3),
+               "UcTerm_StateLayout_t._pointers doesn't match UcTermState_t");
+_Static_assert(LAYOUT_MATCHES(esc_params, _words, 0) &&
+                   LAYOUT_MATCHES(esc_timeout_ms, _words, MAX_ESC_PARAMS),
+               "UcTerm_StateLayout_t._words doesn't match UcTermState_t");
+#undef LAYOUT_MATCHES
+#if defined(UCTERM_HOOK_PRINT_BUF)
+_Static_assert(FLAG_FRAMED == UCTERM_FLAG_FRAMED_,
+               "UCTERM_FLAG_FRAMED_ doesn't match FLAG_FRAMED");
+#endif
+#endif
+
+#if UCTERM_SINGLE_INSTANCE
+// The only instance, at a fixed address (see UCTERM_SINGLE_INSTANCE).
+#if UCTERM_RESUME
+UCTERM_NOINIT
+#endif
+static UcTermState_t _instance;
+#endif
 
 /* Internal storage function prototypes */
 
@@ -80,17 +260,34 @@ static inline UcTermState_t *ucterm_internal(UcTerm_HandleTypeDef *self);
 // Reset the input buffer index, length, and terminate it.
 static inline void _reset_buf(UcTermState_t *self);
 
-// Reset the ESC-sequence buffer and index.
-static inline void _reset_esc_buf(UcTermState_t *self);
+// Reset the ESC-sequence parser to the ground state.
+static inline void _reset_esc(UcTermState_t *self);
+
+// Record the input activity for UcTerm_Tick.
+static inline void _note_input(UcTermState_t *self);
+
+// Update the settings checksum after they change (see UcTerm_Resume).
+static inline void _seal(UcTermState_t *self);
+#if UCTERM_RESUME
+
+// Compute the checksum of the settings (the fields only changed
+// through the public setters).
+static uint16_t _checksum(const UcTermState_t *self);
+
+// Add n bytes to the running checksum.
+static uint16_t _checksum_add(uint16_t sum, const void *data, size_t n);
+#endif
 
 // Shift the input buffer to the left, overwriting the buf[position] symbol
 // and decrease the buffer length by 1.
-static inline void _shift_buf_left(UcTermState_t *self, uint8_t position);
+static inline void _shift_buf_left(UcTermState_t *self,
+                                   UcTerm_Index_t position);
 
 // Shift the input buffer to the right, creating a new symbol at buf[position]
 // and increase the buffer length by 1.
 // Returns the count of new symbols (1 on success, 0 on length limit).
-static inline uint8_t _shift_buf_right(UcTermState_t *self, uint8_t position);
+static inline uint8_t _shift_buf_right(UcTermState_t *self,
+                                       UcTerm_Index_t position);
 
 /* Strings helper function prototypes */
 
@@ -111,18 +308,142 @@ static inline uint8_t _shift_buf_right(UcTermState_t *self, uint8_t position);
 // the unused argv elements aren't modified.
 static inline uint8_t _tokenize(uint8_t *buf, uint8_t *argv[]);
 
+/* Output function prototypes */
+
+// Output a single char with the PrintChar callback
+// or append it to the output frame in PrintBuf mode.
+static inline void _print_char(UcTermState_t *self, uint8_t c);
+
+// Output a null-terminated string with the PrintStr callback
+// or append it to the output frame in PrintBuf mode.
+static inline void _print_str(UcTermState_t *self, const uint8_t *s);
+
+// Invoke the PrintChar hook or callback (shared or legacy).
+static inline void _call_print_char(UcTermState_t *self, uint8_t c);
+
+// Invoke the PrintStr hook or callback (shared or legacy),
+// or PrintChar for each char if the shared one is omitted.
+static inline void _call_print_str(UcTermState_t *self, const uint8_t *s);
+
+// Invoke the PrintBuf hook or callback (shared or legacy).
+static inline void _call_print_buf(UcTermState_t *self, const uint8_t *data,
+                                   size_t len);
+
+// Invoke the Execute hook or callback (shared or legacy).
+static inline void _call_exec(UcTermState_t *self, uint8_t argc,
+                              uint8_t **argv);
+
+// Invoke the Complete hook or callback (shared only).
+// Returns 0 if there's none.
+static inline uint8_t _call_complete(UcTermState_t *self,
+                                     UcTerm_Completion_t *completion);
+
+// Select the frame or the direct output
+// depending on the active PrintBuf callback.
+static inline void _update_output_mode(UcTermState_t *self);
+
+// Pass the output frame contents (if any) to the PrintBuf callback.
+static inline void _flush_frame(UcTermState_t *self);
+
+// Count the bytes stored in the output ring.
+static inline size_t _ring_used(const UcTermState_t *self);
+
+// Check if the output ring lacks the headroom for the next input event.
+static inline uint8_t _is_busy(const UcTermState_t *self);
+
 /* Terminal interaction function prototypes */
 
+// Mark the input buffer contents starting with the specified index
+// as changed (to be redrawn in the deferred mode).
+static inline void _mark_dirty(UcTermState_t *self, UcTerm_Index_t position);
+
+// Bring the terminal line in sync with the input buffer:
+// redraw the changed part and place the cursor (deferred mode only).
+static inline void _render(UcTermState_t *self);
+
+// Forget the terminal line state after a new prompt is printed.
+static inline void _reset_terminal_line(UcTermState_t *self);
+
+// Print a new prompt with the whole line and put the cursor
+// at the current index.
+static inline void _redraw_line(UcTermState_t *self);
+
+// Display a char stored before the current index:
+// echo it or mark it to be drawn in the deferred mode.
+static inline void _display_char(UcTermState_t *self, uint8_t c);
+
+// Display the cursor move between the buffer positions
+// (nothing to do in the deferred mode until render).
+static inline void _display_move(UcTermState_t *self, UcTerm_Index_t from,
+                                 UcTerm_Index_t to);
+
 // Overwrite the current line on the terminal starting with current index
 // and move the cursor back to match the index.
 static inline void _overwrite_terminal_line(UcTermState_t *self);
 
+// Display a char inserted at the current index: open a gap with ICH
+// or overwrite the current line (the char itself isn't printed).
+static inline void _insert_terminal_char(UcTermState_t *self);
+
+// Display the deletion of n chars at the current index:
+// delete them with DCH or overwrite the current line.
+static inline void _delete_terminal_chars(UcTermState_t *self, UcTerm_Index_t n);
+
 // Generate ESC-sequence to move the terminal cursor to
 // match the specified index in the buffer.
-static inline uint8_t *_get_move_command(uint8_t index);
+// The buffer must be at least MAX_CSI_LEN long.
+static inline uint8_t *_get_move_command(uint8_t *buffer,
+                                         UcTerm_Index_t index);
+
+// Generate ESC-sequence with a single numeric parameter
+// (the parameter is omitted if equals 1, which is the default).
+// The buffer must be at least MAX_CSI_LEN long.
+static inline uint8_t *_get_csi_command(uint8_t *buffer, UcTerm_Index_t n,
+                                        uint8_t final);
+
+// Count the decimal digits of the number.
+static inline uint8_t _count_digits(UcTerm_Index_t n);
+
+// Move the terminal cursor between the specified buffer positions
+// with the least number of bytes sent, choosing between
+// raw backspaces, relative (CUB/CUF) and absolute (CHA) moves
+// and reprinting the buffer contents on the way.
+static inline void _move_cursor(UcTermState_t *self, UcTerm_Index_t from,
+                                UcTerm_Index_t to);
 
 /* Input handlers */
 
+// Process a single input character: update the input buffer
+// and the terminal screen accordingly.
+static inline void _process_char(UcTermState_t *self, uint8_t c);
+
+// Process a char while an ESC-sequence is received.
+// Returns 1 if the char is consumed, 0 if it must be processed as usual.
+static inline uint8_t _process_esc(UcTermState_t *self, uint8_t c);
+
+// Execute a complete CSI or SS3 sequence by its final byte.
+static inline void _process_csi(UcTermState_t *self, uint8_t final);
+
+// Execute the input line and start a new one.
+static inline void _process_enter(UcTermState_t *self);
+
+// Delete the symbol before cursor, echo the key and display changes.
+static inline void _process_backspace(UcTermState_t *self, uint8_t c);
+
+// Delete the line contents from the beginning to the cursor.
+static inline void _process_kill_start(UcTermState_t *self);
+
+// Delete the line contents from the cursor to the end.
+static inline void _process_kill_end(UcTermState_t *self);
+
+// Complete the token under the cursor with the Complete callback:
+// insert the common part of the candidates, or list them
+// on the second Tab in a row if there's nothing to insert.
+static inline void _process_tab(UcTermState_t *self);
+
+// Store a printable char at the cursor and display changes.
+static inline void _process_printable(UcTermState_t *self, uint8_t c);
+
 // Move the cli cursor and the buffer index to the starting position.
 static inline void _process_home(UcTermState_t *self);
 
@@ -138,19 +459,214 @@ static inline void _process_right_arrow(UcTermState_t *self);
 // Delete the symbol before cursor and display changes.
 static inline void _process_delete(UcTermState_t *self);
 
+// Check if the char may be appended by _process_append.
+static inline uint8_t _can_append(const UcTermState_t *self, uint8_t c);
+
+// Append a run of printable chars at the end of the line
+// and display changes. The caller must check that they fit.
+static inline void _process_append(UcTermState_t *self, const uint8_t *data,
+                                   UcTerm_Index_t len);
+
+// Insert a run of pasted chars at the cursor and display changes.
+// Non-printable chars are skipped (so the pasted line breaks
+// never execute anything), the excess chars are discarded.
+static inline void _process_paste(UcTermState_t *self, const uint8_t *data,
+                                  size_t len);
+
+/* Lookup tables */
+
+// Packed BCD representation of 0..99 to print the numeric
+// parameters of ESC-sequences without division.
+static FLASH_CONST uint8_t _bcd_table[100] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+};
+
+// Input byte classes: the handler to invoke for each byte value.
+#define O_ CLASS_OTHER
+#define P_ CLASS_PRINTABLE
+#define ES CLASS_ESC
+#define EN CLASS_ENTER
+#define BS CLASS_BACKSPACE
+#define HM CLASS_HOME
+#define ED CLASS_END
+#define LT CLASS_LEFT
+#define RT CLASS_RIGHT
+#define KS CLASS_KILL_START
+#define KE CLASS_KILL_END
+#define TB CLASS_TAB
+static FLASH_CONST uint8_t _byte_class[256] = {
+    O_, HM, LT, O_, O_, ED, RT, O_, BS, TB, EN, KE, O_, EN, O_, O_, // 0x00
+    O_, O_, O_, O_, O_, KS, O_, O_, O_, O_, O_, ES, O_, O_, O_, O_, // 0x10
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x20
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x30
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x40
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x50
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x60
+    P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, BS, // 0x70
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0x80
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0x90
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xA0
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xB0
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xC0
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xD0
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xE0
+    O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, O_, // 0xF0
+};
+#undef O_
+#undef P_
+#undef ES
+#undef EN
+#undef BS
+#undef HM
+#undef ED
+#undef LT
+#undef RT
+#undef KS
+#undef KE
+#undef TB
+
+// ESC-sequence byte classes of the 7-bit bytes (see ECLASS_*).
+#define C0 ECLASS_C0
+#define CN ECLASS_CANCEL
+#define ES ECLASS_ESC
+#define IN ECLASS_INTER
+#define DG ECLASS_DIGIT
+#define SC ECLASS_SEPRTR
+#define PV ECLASS_PRIVATE
+#define LB ECLASS_CSI
+#define SO ECLASS_SS3
+#define FN ECLASS_FINAL
+#define DL ECLASS_DEL
+static FLASH_CONST uint8_t _esc_class[128] = {
+    C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, C0, // 0x00
+    C0, C0, C0, C0, C0, C0, C0, C0, CN, C0, CN, ES, C0, C0, C0, C0, // 0x10
+    IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, IN, // 0x20
+    DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, PV, SC, PV, PV, PV, PV, // 0x30
+    FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, SO, // 0x40
+    FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, LB, FN, FN, FN, FN, // 0x50
+    FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, // 0x60
+    FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, FN, DL, // 0x70
+};
+#undef C0
+#undef CN
+#undef ES
+#undef IN
+#undef DG
+#undef SC
+#undef PV
+#undef LB
+#undef SO
+#undef FN
+#undef DL
+
+// ESC-sequence parser transitions: the next state and the action
+// for each state and byte class.
+#define T ESC_TRANSITION
+#define G ESC_GROUND
+static FLASH_CONST uint8_t _esc_transition[ESC_STATES][ECLASS_COUNT] = {
+    // columns: C0, CANCEL, ESC, INTER, DIGIT, SEPRTR,
+    //          PRIVATE, CSI, SS3, FINAL, DEL, HIGH
+    // GROUND
+    {T(G, EACT_PASS), T(G, EACT_PASS), T(ESC_ESCAPE, EACT_NONE),
+     T(G, EACT_PASS), T(G, EACT_PASS), T(G, EACT_PASS),
+     T(G, EACT_PASS), T(G, EACT_PASS), T(G, EACT_PASS),
+     T(G, EACT_PASS), T(G, EACT_PASS), T(G, EACT_PASS)},
+    // ESCAPE
+    {T(G, EACT_PASS), T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE),
+     T(ESC_ESC_INTER, EACT_NONE), T(G, EACT_NONE), T(G, EACT_NONE),
+     T(G, EACT_NONE), T(ESC_CSI, EACT_CLEAR), T(ESC_SS3, EACT_CLEAR),
+     T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE), T(G, EACT_PASS)},
+    // ESC_INTER
+    {T(G, EACT_PASS), T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE),
+     T(ESC_ESC_INTER, EACT_NONE), T(G, EACT_NONE), T(G, EACT_NONE),
+     T(G, EACT_NONE), T(G, EACT_NONE), T(G, EACT_NONE),
+     T(G, EACT_NONE), T(ESC_ESC_INTER, EACT_NONE), T(G, EACT_PASS)},
+    // CSI
+    {T(G, EACT_PASS), T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE),
+     T(ESC_CSI_IGNORE, EACT_NONE), T(ESC_CSI, EACT_PARAM), T(ESC_CSI, EACT_NEXT),
+     T(ESC_CSI_IGNORE, EACT_NONE), T(G, EACT_DISPATCH), T(G, EACT_DISPATCH),
+     T(G, EACT_DISPATCH), T(ESC_CSI, EACT_NONE), T(G, EACT_PASS)},
+    // CSI_IGNORE
+    {T(G, EACT_PASS), T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE),
+     T(ESC_CSI_IGNORE, EACT_NONE), T(ESC_CSI_IGNORE, EACT_NONE), T(ESC_CSI_IGNORE, EACT_NONE),
+     T(ESC_CSI_IGNORE, EACT_NONE), T(G, EACT_NONE), T(G, EACT_NONE),
+     T(G, EACT_NONE), T(ESC_CSI_IGNORE, EACT_NONE), T(G, EACT_PASS)},
+    // SS3
+    {T(G, EACT_PASS), T(G, EACT_NONE), T(ESC_ESCAPE, EACT_NONE),
+     T(G, EACT_NONE), T(G, EACT_NONE), T(G, EACT_NONE),
+     T(G, EACT_NONE), T(G, EACT_DISPATCH), T(G, EACT_DISPATCH),
+     T(G, EACT_DISPATCH), T(ESC_SS3, EACT_NONE), T(G, EACT_PASS)},
+};
+#undef T
+#undef G
+
 /* Public interface implementation */
 
+#if MAX_STR_LEN > 0
 void UcTerm_Init(UcTerm_HandleTypeDef *self)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  UcTerm_InitWithBuffer(self, ctx->line, MAX_STR_LEN);
+}
+#endif
+
+uint8_t UcTerm_InitWithBuffer(UcTerm_HandleTypeDef *self, uint8_t *line,
+                              size_t cap)
 {
   UcTermState_t *ctx = ucterm_internal(self);
   memset(ctx, 0, sizeof(UcTermState_t));
+  // the terminal columns must fit the index type
+  if (INDEX_MAX - PROMPT_WIDTH < cap)
+  {
+    cap = INDEX_MAX - PROMPT_WIDTH;
+  }
+  // a char and the terminator at least, otherwise
+  // the zero buf_size makes the instance ignore the input
+  if (NULL == line || cap < 2)
+  {
+    return 0;
+  }
+  ctx->buf = line;
+  ctx->buf_size = (UcTerm_Index_t)cap;
+  _reset_buf(ctx);
+  ctx->frame_mtu = MAX_FRAME_LEN;
+  ctx->dirty_from = NOT_DIRTY;
+  ctx->esc_timeout_ms = UCTERM_ESC_TIMEOUT_MS;
+#if UCTERM_USE_ICH_DCH
+  ctx->flags |= FLAG_ICH_DCH;
+#endif
+  _update_output_mode(ctx);
+  _seal(ctx);
+  return 1;
+}
+
+void UcTerm_SetOps(UcTerm_HandleTypeDef *self, const UcTerm_Ops *ops,
+                   void *user)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  _flush_frame(ctx);
+  ctx->ops = ops;
+  ctx->user = user;
+  _update_output_mode(ctx);
+  _seal(ctx);
 }
 
+#if UCTERM_LEGACY_CALLBACKS
 void UcTerm_RegisterPrintCharCallback(UcTerm_HandleTypeDef *self,
                                       void (*printChr)(uint8_t))
 {
   UcTermState_t *ctx = ucterm_internal(self);
   ctx->printChr = printChr;
+  _seal(ctx);
 }
 
 void UcTerm_RegisterPrintStrCallback(UcTerm_HandleTypeDef *self,
@@ -158,321 +674,924 @@ void UcTerm_RegisterPrintStrCallback(UcTerm_HandleTypeDef *self,
 {
   UcTermState_t *ctx = ucterm_internal(self);
   ctx->printStr = printStr;
+  _seal(ctx);
 }
 
-void UcTerm_RegisterExecuteCallback(UcTerm_HandleTypeDef *self,
-                                    void (*execute)(uint8_t, uint8_t **))
+void UcTerm_RegisterPrintBufCallback(UcTerm_HandleTypeDef *self,
+                                     void (*printBuf)(const uint8_t *,
+                                                      size_t))
 {
   UcTermState_t *ctx = ucterm_internal(self);
-  ctx->exec = execute;
+  _flush_frame(ctx);
+  ctx->printBuf = printBuf;
+  _update_output_mode(ctx);
+  _seal(ctx);
 }
+#endif
 
-void UcTerm_ShowPrompt(UcTerm_HandleTypeDef *self)
+void UcTerm_SetFrameMtu(UcTerm_HandleTypeDef *self, size_t mtu)
 {
   UcTermState_t *ctx = ucterm_internal(self);
-  ctx->printStr(OUT_PROMPT_STR);
+  if (0 == mtu || MAX_FRAME_LEN < mtu)
+  {
+    mtu = MAX_FRAME_LEN;
+  }
+  if (ctx->frame_len >= mtu)
+  {
+    _flush_frame(ctx);
+  }
+  ctx->frame_mtu = (uint8_t)mtu;
+  _seal(ctx);
 }
 
-void UcTerm_IngestChar(UcTerm_HandleTypeDef *self, uint8_t c)
+void UcTerm_SetOutputRing(UcTerm_HandleTypeDef *self, uint8_t *ring,
+                          size_t size)
 {
   UcTermState_t *ctx = ucterm_internal(self);
+  _flush_frame(ctx);
+  ctx->ring = (1 < size) ? ring : NULL;
+  ctx->ring_size = size;
+  ctx->ring_head = 0;
+  ctx->ring_tail = 0;
+  _seal(ctx);
+}
 
-  // check if this is an ESC sequence
-  // (the first element of the esc_buf is used as a state switch):
-  if (ESC_HEADER == c)
+size_t UcTerm_ReadOutput(UcTerm_HandleTypeDef *self, uint8_t *buf,
+                         size_t max)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  size_t count = 0;
+  size_t tail = ctx->ring_tail;
+  if (NULL == ctx->ring)
   {
-    ctx->esc_buf[0] = ESC_HEADER;
-    return;
+    return 0;
   }
-  if (ESC_SEPRTR == c)
+  // the ring is drained: time to output the postponed changes
+  if (tail == ctx->ring_head)
   {
-    if (ESC_HEADER == ctx->esc_buf[0])
-    {
-      ctx->esc_buf[0] = ESC_SEPRTR;
-      ctx->esc_index = 1;
-      return;
-    }
-    else
-    {
-      _reset_esc_buf(ctx);
-    }
+    _render(ctx);
   }
-  if (ESC_SEPRTR == ctx->esc_buf[0])
+  while (count < max && tail != ctx->ring_head)
   {
-    // ESC sequence detected:
-    // check total length
-    if (MAX_ESC_LEN <= ctx->esc_index)
+    buf[count++] = ctx->ring[tail++];
+    if (tail == ctx->ring_size)
     {
-      // sequence is too long, discard the buffer
-      ctx->printStr(OUT_UNKNOWN_STR);
-      _reset_esc_buf(ctx);
-      return;
-    }
-    // ingest the symbol
-    ctx->esc_buf[ctx->esc_index++] = c;
-    // if the last byte is in the range 0x40–0x7E
-    // then the sequence is terminated, process it
-    if (0x40 <= c && 0x7E >= c)
-    {
-      // [D  Arrow left
-      // [C  Arrow right
-      // [1~ Home key
-      // [4~ End key
-      // [3~ Delete key
-      if (2 == ctx->esc_index)
-      {
-        if ('D' == c)
-        {
-          _process_left_arrow(ctx);
-        }
-        else if ('C' == c)
-        {
-          _process_right_arrow(ctx);
-        }
-      }
-      else if (3 == ctx->esc_index && '~' == c)
-      {
-        if ('1' == ctx->esc_buf[1])
-        {
-          _process_home(ctx);
-        }
-        else if ('4' == ctx->esc_buf[1])
-        {
-          _process_end(ctx);
-        }
-        else if ('3' == ctx->esc_buf[1])
-        {
-          _process_delete(ctx);
-        }
-      }
-      _reset_esc_buf(ctx);
+      tail = 0;
     }
-    return;
   }
+  ctx->ring_tail = tail;
+  return count;
+}
+
+uint8_t UcTerm_IsBusy(UcTerm_HandleTypeDef *self)
+{
+  return _is_busy(ucterm_internal(self));
+}
 
-  // process Enter
-  if (KEY_ENTER_CR == c || KEY_ENTER_LF == c)
+void UcTerm_SetInsertDeleteMode(UcTerm_HandleTypeDef *self, uint8_t enable)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  if (enable)
   {
-    // early return if no input
-    if (0 == ctx->length)
-    {
-      ctx->printStr(OUT_PROMPT_STR); 
-      return;
-    }
-    // terminate the string
-    ctx->buf[ctx->length] = '\0';
-    // find tokens and invoke callback if any
-    memset(ctx->argv, '\0', MAX_ARG_COUNT * sizeof(uint8_t *));
-    ctx->argc = _tokenize(ctx->buf, ctx->argv);
-    if (ctx->argc > 0)
+    ctx->flags |= FLAG_ICH_DCH;
+  }
+  else
+  {
+    ctx->flags &= ~FLAG_ICH_DCH;
+  }
+  _seal(ctx);
+}
+
+void UcTerm_SetDeferredRendering(UcTerm_HandleTypeDef *self, uint8_t enable)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  if (enable)
+  {
+    if (!(ctx->flags & FLAG_DEFERRED))
     {
-      ctx->printStr(OUT_NEWLINE_STR);
-      ctx->exec(ctx->argc, ctx->argv);
+      // the terminal is in sync so far
+      ctx->term_index = ctx->index;
+      ctx->term_length = ctx->length;
+      ctx->dirty_from = NOT_DIRTY;
+      ctx->flags |= FLAG_DEFERRED;
     }
-    // reset the buffers - get ready for a new input line
-    _reset_buf(ctx);
-    _reset_esc_buf(ctx);
-    ctx->printStr(OUT_PROMPT_STR); 
-    return;
   }
+  else
+  {
+    _render(ctx);
+    _flush_frame(ctx);
+    ctx->flags &= ~FLAG_DEFERRED;
+  }
+  _seal(ctx);
+}
+
+void UcTerm_Flush(UcTerm_HandleTypeDef *self)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  _render(ctx);
+  _flush_frame(ctx);
+}
+
+#if UCTERM_LEGACY_CALLBACKS
+void UcTerm_RegisterExecuteCallback(UcTerm_HandleTypeDef *self,
+                                    void (*execute)(uint8_t, uint8_t **))
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  ctx->exec = execute;
+  _seal(ctx);
+}
+#endif
+
+void UcTerm_ShowPrompt(UcTerm_HandleTypeDef *self)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  _render(ctx);
+  _print_str(ctx, OUT_PROMPT_STR);
+  _reset_terminal_line(ctx);
+  _flush_frame(ctx);
+}
 
-  // process Backspace
-  if (KEY_BACKSPACE == c || KEY_DELETE == c)
+uint8_t UcTerm_CompletionAdd(UcTerm_Completion_t *completion,
+                             const uint8_t *candidate)
+{
+  UcTermState_t *ctx = (UcTermState_t *)completion->_state;
+  const uint8_t *suffix = candidate + completion->length;
+  UcTerm_Index_t common = 0;
+  // stops at the end of a candidate shorter than the token
+  if (0 != strncmp((const char *)candidate,
+                   (const char *)&completion->line[completion->start],
+                   completion->length))
+  {
+    // doesn't complete the token
+    return 1;
+  }
+  if (completion->_listing)
   {
-    if (0 == ctx->index)
+    // the ring must still take the line redraw after the listing
+    if (UCTERM_MAX_COMPLETIONS <= completion->_count ||
+        (NULL != ctx->ring &&
+         ctx->ring_size - 1 - _ring_used(ctx) <
+             RING_HEADROOM(ctx) + LIST_RESERVE + strlen((const char *)candidate)))
     {
-      return;
+      _print_str(ctx, OUT_MORE_STR);
+      return 0;
     }
-    _shift_buf_left(ctx, ctx->index - 1);
-    ctx->index--;
-    ctx->printChr(c);
-    if (ctx->index < ctx->length)
+    _print_str(ctx, (0 == completion->_count) ? OUT_NEWLINE_STR
+                                               : OUT_TAB_STR);
+    _print_str(ctx, candidate);
+    completion->_count++;
+    return 1;
+  }
+  // the common part of the suffixes is kept in the scratch
+  // (see _process_tab)
+  if (0 == completion->_count)
+  {
+    while ('\0' != suffix[common] && common < completion->_room)
     {
-      _overwrite_terminal_line(ctx);
+      completion->_scratch[common] = suffix[common];
+      common++;
     }
-    return;
+    completion->_partial = ('\0' != suffix[common]);
   }
-
-  // Home
-  if (CTRL_A == c)
+  else
   {
-    _process_home(ctx);
-    return;
+    while (common < completion->_common &&
+           completion->_scratch[common] == suffix[common])
+    {
+      common++;
+    }
   }
+  completion->_common = common;
+  completion->_count++;
+  // nothing more to learn from the rest of the candidates
+  return (1 == completion->_count || 0 < common);
+}
 
-  // End
-  if (CTRL_E == c)
+#if UCTERM_RESUME
+uint8_t UcTerm_Resume(UcTerm_HandleTypeDef *self)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  if (ctx->checksum != _checksum(ctx) || ctx->buf_size <= ctx->length ||
+      ctx->length < ctx->index || '\0' != ctx->buf[ctx->length])
   {
-    _process_end(ctx);
-    return;
+    return 0;
   }
+  // the sequence in progress (or a paste), and the pending output are lost
+  ctx->flags &= FLAG_SETTINGS;
+  _reset_esc(ctx);
+  ctx->frame_len = 0;
+  ctx->ring_head = 0;
+  ctx->ring_tail = 0;
+  // the terminal may have been reset too, so show the line again
+  _redraw_line(ctx);
+  _flush_frame(ctx);
+  return 1;
+}
+#endif
+
+void UcTerm_SetEscTimeout(UcTerm_HandleTypeDef *self, uint16_t timeout_ms)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  ctx->esc_timeout_ms = timeout_ms;
+  _seal(ctx);
+}
 
-  // Left Arrow
-  if (Ctrl_B == c)
+void UcTerm_Tick(UcTerm_HandleTypeDef *self, uint32_t now_ms)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  ctx->now_ms = now_ms;
+  // the rest of the ESC-sequence is lost (or it was a lone ESC key),
+  // let the following input be processed as usual
+  if (ESC_GROUND != ctx->esc_state && 0 != ctx->esc_timeout_ms &&
+      ctx->esc_timeout_ms <= (uint32_t)(now_ms - ctx->esc_time_ms))
   {
-    _process_left_arrow(ctx);
+    _reset_esc(ctx);
   }
-
-  // Right Arrow
-  if (Ctrl_F == c)
+  // the paste end (ESC[201~) is lost, take Enter as usual again
+  if ((ctx->flags & FLAG_PASTE) && 0 != ctx->esc_timeout_ms &&
+      ctx->esc_timeout_ms <= (uint32_t)(now_ms - ctx->esc_time_ms))
   {
-    _process_right_arrow(ctx);
+    ctx->flags &= ~FLAG_PASTE;
   }
-
-  // process Ctrl+U: Delete to the beginning of the line
-  if (CTRL_U == c)
+  // the input is idle, send everything pending
+  if (!(ctx->flags & FLAG_INPUT))
   {
-    if (0 == ctx->index)
-    {
-      return;
-    }
-    memmove(&ctx->buf[0], &ctx->buf[ctx->index], ctx->length - ctx->index + 1);
-    ctx->length -= ctx->index;
-    ctx->index = 0;
-    _process_home(ctx);
-    _overwrite_terminal_line(ctx);
-    return;
+    _render(ctx);
+    _flush_frame(ctx);
   }
+  ctx->flags &= ~FLAG_INPUT;
+}
 
-  // process Ctrl+K: Delete to the end of the line
-  if (CTRL_K == c)
+void UcTerm_IngestChar(UcTerm_HandleTypeDef *self, uint8_t c)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  if (0 == ctx->buf_size)
   {
-    if (ctx->index < ctx->length)
-    {
-      ctx->buf[ctx->index] = '\0';
-      ctx->length = ctx->index;
-      _overwrite_terminal_line(ctx);
-    }
     return;
   }
+  _process_char(ctx, c);
+  _note_input(ctx);
+  _flush_frame(ctx);
+}
 
-  // check buffer length (one char is reserved for termination)
-  if ((MAX_STR_LEN - 2) < ctx->index)
+size_t UcTerm_IngestBuffer(UcTerm_HandleTypeDef *self, const uint8_t *data,
+                           size_t len)
+{
+  UcTermState_t *ctx = ucterm_internal(self);
+  const uint8_t *end = data + len;
+  if (0 == ctx->buf_size)
   {
-    // input too long, show error
-    ctx->printStr(OUT_UNKNOWN_STR);
-    _reset_buf(ctx);
-    _reset_esc_buf(ctx);
-    return;
+    return 0;
   }
-
-  // store and echo printable characters
-  if (0x20 <= c && 0x7E >= c)
+  while (data < end)
   {
-    if (ctx->index < ctx->length)
+    // the output of the next event may not fit the ring,
+    // leave the rest until it's drained
+    if (_is_busy(ctx))
+    {
+      break;
+    }
+    // inside a bracketed paste, take everything up to
+    // the next ESC-sequence (hopefully ESC[201~) at once
+    if ((ctx->flags & FLAG_PASTE) && ESC_GROUND == ctx->esc_state &&
+        ESC_HEADER != *data)
     {
-      if (_shift_buf_right(ctx, ctx->index))
+      const uint8_t *run = data;
+      while (data < end && ESC_HEADER != *data)
       {
-        _overwrite_terminal_line(ctx);
+        data++;
       }
-      else
+      _process_paste(ctx, run, data - run);
+      continue;
+    }
+#if UCTERM_FAST_APPEND
+    // typing or pasting at the end of the line: take the whole
+    // printable run that fits, the rest goes the regular way
+    if (_can_append(ctx, *data))
+    {
+      const uint8_t *run = data++;
+      UcTerm_Index_t room = (ctx->buf_size - 1) - ctx->length;
+      while (data < end && (data - run) < room && IS_PRINTABLE(*data))
       {
-        // buffer overflow, discard the character
-        return;
+        data++;
       }
-    } else 
-    {
-      ctx->length++;
+      _process_append(ctx, run, data - run);
+      continue;
     }
-    ctx->buf[ctx->index++] = c;
-    ctx->printChr(c);
-    return;
+#endif
+    _process_char(ctx, *(data++));
   }
+  _note_input(ctx);
+  _flush_frame(ctx);
+  return len - (size_t)(end - data);
 }
 
 /* Private functions implementation */
 
 static inline UcTermState_t *ucterm_internal(UcTerm_HandleTypeDef *self)
 {
+#if UCTERM_SINGLE_INSTANCE
+  (void)self;
+  return &_instance;
+#else
   return (UcTermState_t *)(self->storage);
+#endif
 }
 
-static inline void _reset_buf(UcTermState_t *self)
+static inline void _process_char(UcTermState_t *self, uint8_t c)
 {
-  self->length = 0;
-  self->index = 0;
-  self->buf[0] = '\0';
-}
+  uint8_t byte_class = READ_FLASH_BYTE(&_byte_class[c]);
 
-static inline void _reset_esc_buf(UcTermState_t *self)
-{
-  self->esc_buf[0] = '\0';
-  self->esc_index = 0;
-}
+#if UCTERM_FAST_APPEND
+  // the most common case first
+  if (CLASS_PRINTABLE == byte_class && _can_append(self, c))
+  {
+    _process_append(self, &c, 1);
+    return;
+  }
+#endif
 
-static inline void _shift_buf_left(UcTermState_t *self, uint8_t position)
-{
-  if (position >= self->length)
+  // any other key breaks a Tab series
+  if (CLASS_TAB != byte_class)
+  {
+    self->flags &= ~FLAG_TAB;
+  }
+
+  // check if this is an ESC sequence
+  if (CLASS_ESC == byte_class || ESC_GROUND != self->esc_state)
+  {
+    if (_process_esc(self, c))
+    {
+      return;
+    }
+  }
+
+  // pasted text is inserted as is
+  if (self->flags & FLAG_PASTE)
   {
+    _process_paste(self, &c, 1);
     return;
   }
-  memmove(&self->buf[position], &self->buf[position + 1],
-          self->length - position);
-  self->length--;
-  self->buf[self->length] = '\0';
+
+  switch (byte_class)
+  {
+  case CLASS_PRINTABLE:
+    _process_printable(self, c);
+    break;
+  case CLASS_ENTER:
+    _process_enter(self);
+    break;
+  case CLASS_BACKSPACE:
+    _process_backspace(self, c);
+    break;
+  case CLASS_HOME:
+    _process_home(self);
+    break;
+  case CLASS_END:
+    _process_end(self);
+    break;
+  case CLASS_LEFT:
+    _process_left_arrow(self);
+    break;
+  case CLASS_RIGHT:
+    _process_right_arrow(self);
+    break;
+  case CLASS_KILL_START:
+    _process_kill_start(self);
+    break;
+  case CLASS_KILL_END:
+    _process_kill_end(self);
+    break;
+  case CLASS_TAB:
+    _process_tab(self);
+    break;
+  default:
+    // unsupported control chars are ignored
+    break;
+  }
 }
 
-static inline uint8_t _shift_buf_right(UcTermState_t *self, uint8_t position)
+static inline uint8_t _process_esc(UcTermState_t *self, uint8_t c)
 {
-  if ((MAX_STR_LEN - 2) < self->length)
+  uint8_t esc_class = (c & 0x80) ? ECLASS_HIGH : READ_FLASH_BYTE(&_esc_class[c]);
+  uint8_t transition = READ_FLASH_BYTE(&_esc_transition[self->esc_state][esc_class]);
+  self->esc_state = transition >> 4;
+  switch (transition & 0x0F)
   {
+  case EACT_PASS:
     return 0;
+  case EACT_CLEAR:
+    memset(self->esc_params, 0, sizeof(self->esc_params));
+    self->esc_param_index = 0;
+    break;
+  case EACT_PARAM:
+    if (self->esc_param_index < MAX_ESC_PARAMS)
+    {
+      uint16_t *param = &self->esc_params[self->esc_param_index];
+      uint8_t digit = c - '0';
+      // saturate before the product can overflow 16 bits
+      if ((MAX_ESC_PARAM_VALUE - digit) / 10 < *param)
+      {
+        *param = MAX_ESC_PARAM_VALUE;
+      }
+      else
+      {
+        *param = *param * 10 + digit;
+      }
+    }
+    break;
+  case EACT_NEXT:
+    if (self->esc_param_index < MAX_ESC_PARAMS)
+    {
+      self->esc_param_index++;
+    }
+    break;
+  case EACT_DISPATCH:
+    _process_csi(self, c);
+    break;
+  default:
+    break;
   }
-  memmove(&self->buf[position + 1], &self->buf[position],
-          self->length - position + 1);
-  self->length++;
-  self->buf[self->length] = '\0';
   return 1;
 }
 
-static inline uint8_t *_get_move_command(uint8_t index)
+static inline void _process_csi(UcTermState_t *self, uint8_t final)
 {
-  // buffer to contain command sequence
-  static uint8_t buffer[8] = {
-      0x1B,
-      '[',
-  };
-  // buffer write position
-  uint8_t i = 2;
-  // shortcut for the first column
-  if (index == 0)
-  {
-    return OUT_CHA_2;
-  }
-  // prevent wrap and out-of-range columns
-  if (index >= (255 - PROMPT_WIDTH))
-  {
-    index = 255 - PROMPT_WIDTH;
-  }
-  // column numbers start with 1, then
-  // we reserve some space for the cli prompt
-  index += (1 + PROMPT_WIDTH);
-  // calculate hundreds
-  if (index >= 100)
+  // CSI and SS3 sequences share the final bytes,
+  // the modifiers (i.e. ESC[1;5C for Ctrl+Right) are ignored,
+  // the rest of the sequences (i.e. ESC[A, ESC[5~, DSR replies) are skipped
+  switch (final)
   {
-    for (buffer[i] = '0'; index >= 100; index -= 100)
+  case 'D': // Arrow left
+    _process_left_arrow(self);
+    break;
+  case 'C': // Arrow right
+    _process_right_arrow(self);
+    break;
+  case 'H': // Home key
+    _process_home(self);
+    break;
+  case 'F': // End key
+    _process_end(self);
+    break;
+  case '~': // VT keys
+    switch (self->esc_params[0])
     {
-      buffer[i]++;
+    case 1: // Home key
+    case 7:
+      _process_home(self);
+      break;
+    case 4: // End key
+    case 8:
+      _process_end(self);
+      break;
+    case 3: // Delete key
+      _process_delete(self);
+      break;
+    case 200: // Bracketed paste start
+      self->flags |= FLAG_PASTE;
+      break;
+    case 201: // Bracketed paste end
+      self->flags &= ~FLAG_PASTE;
+      break;
+    default:
+      break;
     }
-    i++;
+    break;
+  default:
+    break;
   }
-  // calculate tens
-  if (index >= 10)
+}
+
+static inline void _process_enter(UcTermState_t *self)
+{
+  // early return if no input
+  if (0 == self->length)
+  {
+    _render(self);
+    _print_str(self, OUT_PROMPT_STR); 
+    _reset_terminal_line(self);
+    return;
+  }
+  // show the final state of the line before the command output
+  _render(self);
+  // terminate the string
+  self->buf[self->length] = '\0';
+  // find tokens and invoke callback if any
+  // (the pointers are only needed for the callback, keep them on stack)
+  uint8_t *argv[MAX_ARG_COUNT] = {0};
+  uint8_t argc = _tokenize(self->buf, argv);
+  if (argc > 0)
+  {
+    _print_str(self, OUT_NEWLINE_STR);
+    // the command output must follow the echo
+    _flush_frame(self);
+    _call_exec(self, argc, argv);
+  }
+  // reset the buffers - get ready for a new input line
+  _reset_buf(self);
+  _reset_esc(self);
+  _print_str(self, OUT_PROMPT_STR); 
+  _reset_terminal_line(self);
+}
+
+static inline void _process_backspace(UcTermState_t *self, uint8_t c)
+{
+  if (0 == self->index)
+  {
+    return;
+  }
+  _shift_buf_left(self, self->index - 1);
+  self->index--;
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index);
+    return;
+  }
+  _print_char(self, c);
+  if (self->index < self->length)
+  {
+    _delete_terminal_chars(self, 1);
+  }
+}
+
+static inline void _process_kill_start(UcTermState_t *self)
+{
+  UcTerm_Index_t cut = self->index;
+  if (0 == cut)
+  {
+    return;
+  }
+  _process_home(self);
+  memmove(&self->buf[0], &self->buf[cut], self->length - cut + 1);
+  self->length -= cut;
+  _delete_terminal_chars(self, cut);
+}
+
+static inline void _process_kill_end(UcTermState_t *self)
+{
+  if (self->index < self->length)
+  {
+    self->buf[self->index] = '\0';
+    self->length = self->index;
+    _overwrite_terminal_line(self);
+  }
+}
+
+static inline void _process_printable(UcTermState_t *self, uint8_t c)
+{
+  // check buffer length (one char is reserved for termination)
+  if ((self->buf_size - 2) < self->index)
+  {
+    // input too long, show error
+    _render(self);
+    _print_str(self, OUT_UNKNOWN_STR);
+    _reset_buf(self);
+    _reset_esc(self);
+    _reset_terminal_line(self);
+    return;
+  }
+  if (self->index < self->length)
+  {
+    if (_shift_buf_right(self, self->index))
+    {
+      _insert_terminal_char(self);
+    }
+    else
+    {
+      // buffer overflow, discard the character
+      return;
+    }
+  }
+  else
+  {
+    self->length++;
+    self->buf[self->length] = '\0';
+  }
+  self->buf[self->index++] = c;
+  _display_char(self, c);
+}
+
+static inline void _reset_buf(UcTermState_t *self)
+{
+  self->length = 0;
+  self->index = 0;
+  self->buf[0] = '\0';
+}
+
+static inline void _reset_esc(UcTermState_t *self)
+{
+  self->esc_state = ESC_GROUND;
+}
+
+static inline void _note_input(UcTermState_t *self)
+{
+  self->flags |= FLAG_INPUT;
+  if (ESC_GROUND != self->esc_state || (self->flags & FLAG_PASTE))
+  {
+    self->esc_time_ms = self->now_ms;
+  }
+}
+
+static inline void _seal(UcTermState_t *self)
+{
+#if UCTERM_RESUME
+  self->checksum = _checksum(self);
+#else
+  (void)self;
+#endif
+}
+#if UCTERM_RESUME
+
+static uint16_t _checksum(const UcTermState_t *self)
+{
+  // a zeroed storage never matches the seed
+  uint16_t sum = 0x5A5A;
+  uint8_t flags = self->flags & FLAG_SETTINGS;
+  sum = _checksum_add(sum, &flags, sizeof(flags));
+  sum = _checksum_add(sum, &self->buf_size, sizeof(self->buf_size));
+  sum = _checksum_add(sum, &self->frame_mtu, sizeof(self->frame_mtu));
+  sum = _checksum_add(sum, &self->buf, sizeof(self->buf));
+  sum = _checksum_add(sum, &self->ring, sizeof(self->ring));
+  sum = _checksum_add(sum, &self->ring_size, sizeof(self->ring_size));
+  sum = _checksum_add(sum, &self->ops, sizeof(self->ops));
+  sum = _checksum_add(sum, &self->user, sizeof(self->user));
+#if UCTERM_LEGACY_CALLBACKS
+  sum = _checksum_add(sum, &self->printChr, sizeof(self->printChr));
+  sum = _checksum_add(sum, &self->printStr, sizeof(self->printStr));
+  sum = _checksum_add(sum, &self->printBuf, sizeof(self->printBuf));
+  sum = _checksum_add(sum, &self->exec, sizeof(self->exec));
+#endif
+  sum = _checksum_add(sum, &self->esc_timeout_ms,
+                      sizeof(self->esc_timeout_ms));
+  return sum;
+}
+
+static uint16_t _checksum_add(uint16_t sum, const void *data, size_t n)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (0 < n--)
+  {
+    // rotate, so swapped bytes change the sum
+    sum = (uint16_t)(((sum << 1) | (sum >> 15)) + *(bytes++));
+  }
+  return sum;
+}
+#endif
+
+static inline void _shift_buf_left(UcTermState_t *self,
+                                   UcTerm_Index_t position)
+{
+  if (position >= self->length)
+  {
+    return;
+  }
+  memmove(&self->buf[position], &self->buf[position + 1],
+          self->length - position);
+  self->length--;
+  self->buf[self->length] = '\0';
+}
+
+static inline uint8_t _shift_buf_right(UcTermState_t *self,
+                                       UcTerm_Index_t position)
+{
+  if ((self->buf_size - 2) < self->length)
+  {
+    return 0;
+  }
+  memmove(&self->buf[position + 1], &self->buf[position],
+          self->length - position + 1);
+  self->length++;
+  self->buf[self->length] = '\0';
+  return 1;
+}
+
+static inline void _mark_dirty(UcTermState_t *self, UcTerm_Index_t position)
+{
+  if (position < self->dirty_from)
+  {
+    self->dirty_from = position;
+  }
+}
+
+static inline void _render(UcTermState_t *self)
+{
+  if (!(self->flags & FLAG_DEFERRED))
+  {
+    return;
+  }
+  if (NOT_DIRTY != self->dirty_from)
+  {
+    // the terminal contents before dirty_from are valid,
+    // so the cursor may pass there by reprinting them
+    _move_cursor(self, self->term_index, self->dirty_from);
+    _print_str(self, &self->buf[self->dirty_from]);
+    if (self->term_length > self->length)
+    {
+      _print_str(self, OUT_ERASE_END);
+    }
+    self->term_index = self->length;
+    self->term_length = self->length;
+    self->dirty_from = NOT_DIRTY;
+  }
+  _move_cursor(self, self->term_index, self->index);
+  self->term_index = self->index;
+}
+
+static inline void _reset_terminal_line(UcTermState_t *self)
+{
+  self->term_index = 0;
+  self->term_length = 0;
+  self->dirty_from = NOT_DIRTY;
+}
+
+static inline void _redraw_line(UcTermState_t *self)
+{
+  _print_str(self, OUT_PROMPT_STR);
+  _print_str(self, self->buf);
+  _reset_terminal_line(self);
+  self->term_length = self->length;
+  _move_cursor(self, self->length, self->index);
+  self->term_index = self->index;
+}
+
+static inline void _display_char(UcTermState_t *self, uint8_t c)
+{
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index - 1);
+  }
+  else
+  {
+    _print_char(self, c);
+  }
+}
+
+static inline void _display_move(UcTermState_t *self, UcTerm_Index_t from,
+                                 UcTerm_Index_t to)
+{
+  if (!(self->flags & FLAG_DEFERRED))
   {
-    for (buffer[i] = '0'; index >= 10; index -= 10)
+    _move_cursor(self, from, to);
+  }
+}
+
+static inline void _insert_terminal_char(UcTermState_t *self)
+{
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index);
+  }
+  else if (self->flags & FLAG_ICH_DCH)
+  {
+    _print_str(self, OUT_INSERT_CHAR);
+  }
+  else
+  {
+    _overwrite_terminal_line(self);
+  }
+}
+
+static inline void _delete_terminal_chars(UcTermState_t *self, UcTerm_Index_t n)
+{
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index);
+  }
+  else if (self->flags & FLAG_ICH_DCH)
+  {
+    uint8_t cmd[MAX_CSI_LEN];
+    _print_str(self, _get_csi_command(cmd, n, CSI_DCH));
+  }
+  else
+  {
+    _overwrite_terminal_line(self);
+  }
+}
+
+static inline uint8_t *_get_move_command(uint8_t *buffer,
+                                         UcTerm_Index_t index)
+{
+  // prevent wrap and out-of-range columns
+  if (index >= (INDEX_MAX - 1 - PROMPT_WIDTH))
+  {
+    index = INDEX_MAX - 1 - PROMPT_WIDTH;
+  }
+  // column numbers start with 1, then
+  // we reserve some space for the cli prompt
+  return _get_csi_command(buffer, index + 1 + PROMPT_WIDTH, CSI_CHA);
+}
+
+static inline uint8_t *_get_csi_command(uint8_t *buffer, UcTerm_Index_t n,
+                                        uint8_t final)
+{
+  // buffer write position
+  uint8_t i = 2;
+  buffer[0] = ESC_HEADER;
+  buffer[1] = ESC_SEPRTR;
+  if (1 != n)
+  {
+    uint8_t bcd;
+#if UCTERM_INDEX_BITS > 8
+    // leading digits by subtraction, as there is no division
+    static const uint16_t powers[] = {10000, 1000, 100};
+    for (uint8_t p = 0; p < sizeof(powers) / sizeof(powers[0]); p++)
+    {
+      uint8_t digit = 0;
+      while (n >= powers[p])
+      {
+        n -= powers[p];
+        digit++;
+      }
+      if (2 < i || 0 < digit)
+      {
+        buffer[i++] = '0' + digit;
+      }
+    }
+#else
+    // hundreds
+    if (n >= 200)
+    {
+      buffer[i++] = '2';
+      n -= 200;
+    }
+    else if (n >= 100)
+    {
+      buffer[i++] = '1';
+      n -= 100;
+    }
+#endif
+    // tens (if significant) and ones
+    bcd = READ_FLASH_BYTE(&_bcd_table[n]);
+    if (2 < i || 0x10 <= bcd)
     {
-      buffer[i]++;
+      buffer[i++] = '0' + (bcd >> 4);
     }
-    i++;
+    buffer[i++] = '0' + (bcd & 0x0F);
   }
-  // calculate ones
-  buffer[i++] = '0' + index;
   // finalize the command sequence
-  buffer[i++] = 'G';
+  buffer[i++] = final;
   buffer[i++] = '\0';
   return buffer;
 }
 
+static inline uint8_t _count_digits(UcTerm_Index_t n)
+{
+#if UCTERM_INDEX_BITS > 8
+  if (n >= 1000)
+  {
+    return (n >= 10000) ? 5 : 4;
+  }
+#endif
+  return (n >= 100) ? 3 : ((n >= 10) ? 2 : 1);
+}
+
+static inline void _move_cursor(UcTermState_t *self, UcTerm_Index_t from,
+                                UcTerm_Index_t to)
+{
+  uint8_t cmd[MAX_CSI_LEN];
+  UcTerm_Index_t distance;
+  uint8_t rel_cost;
+  uint8_t abs_cost;
+  if (from == to)
+  {
+    return;
+  }
+  distance = (from > to) ? (from - to) : (to - from);
+  // ESC [ n D or ESC [ n C, n is omitted for a single column
+  rel_cost = 3 + ((1 == distance) ? 0 : _count_digits(distance));
+  // ESC [ n G
+  abs_cost = 3 + _count_digits(to + 1 + PROMPT_WIDTH);
+  if (distance <= rel_cost && distance <= abs_cost)
+  {
+    // one byte per column: backspaces to the left,
+    // the characters already on the screen to the right
+    if (from > to)
+    {
+      for (; distance > 0; distance--)
+      {
+        _print_char(self, OUT_BACKSPACE);
+      }
+    }
+    else
+    {
+      for (; from < to; from++)
+      {
+        _print_char(self, self->buf[from]);
+      }
+    }
+  }
+  else if (rel_cost <= abs_cost)
+  {
+    _print_str(self, _get_csi_command(cmd, distance,
+                                      (from > to) ? CSI_CUB : CSI_CUF));
+  }
+  else
+  {
+    _print_str(self, _get_move_command(cmd, to));
+  }
+}
+
 static inline uint8_t _tokenize(uint8_t *buf, uint8_t *argv[])
 {
   uint8_t argc = 0;
@@ -510,35 +1629,248 @@ static inline uint8_t _tokenize(uint8_t *buf, uint8_t *argv[])
   return argc;
 }
 
+static inline void _print_char(UcTermState_t *self, uint8_t c)
+{
+  if (NULL != self->ring)
+  {
+    size_t head = self->ring_head + 1;
+    if (head == self->ring_size)
+    {
+      head = 0;
+    }
+    // the ring is full (the input wasn't paused on UcTerm_IsBusy),
+    // nothing to do but drop the char
+    if (head == self->ring_tail)
+    {
+      return;
+    }
+    self->ring[self->ring_head] = c;
+    self->ring_head = head;
+    return;
+  }
+  if (!(self->flags & FLAG_FRAMED))
+  {
+    _call_print_char(self, c);
+    return;
+  }
+#if MAX_FRAME_LEN > 0
+  self->frame[self->frame_len++] = c;
+  if (self->frame_len >= self->frame_mtu)
+  {
+    _flush_frame(self);
+  }
+#else
+  // no frame to collect the output in
+  _call_print_buf(self, &c, 1);
+#endif
+}
+
+static inline void _print_str(UcTermState_t *self, const uint8_t *s)
+{
+  if (NULL == self->ring && !(self->flags & FLAG_FRAMED))
+  {
+    _call_print_str(self, s);
+    return;
+  }
+  while ('\0' != *s)
+  {
+    _print_char(self, *(s++));
+  }
+}
+
+static inline void _update_output_mode(UcTermState_t *self)
+{
+#if defined(UCTERM_HOOK_PRINT_BUF)
+  self->flags |= FLAG_FRAMED;
+  return;
+#endif
+  self->flags &= ~FLAG_FRAMED;
+  if (NULL != self->ops)
+  {
+    if (NULL != self->ops->printBuf)
+    {
+      self->flags |= FLAG_FRAMED;
+    }
+    return;
+  }
+#if UCTERM_LEGACY_CALLBACKS
+  if (NULL != self->printBuf)
+  {
+    self->flags |= FLAG_FRAMED;
+  }
+#endif
+}
+
+static inline void _call_print_char(UcTermState_t *self, uint8_t c)
+{
+#if defined(UCTERM_HOOK_PRINT_CHAR)
+  (void)self;
+  UCTERM_HOOK_PRINT_CHAR(c);
+  return;
+#endif
+#if UCTERM_LEGACY_CALLBACKS
+  if (NULL == self->ops)
+  {
+    self->printChr(c);
+    return;
+  }
+#endif
+  self->ops->printChr(self->user, c);
+}
+
+static inline void _call_print_str(UcTermState_t *self, const uint8_t *s)
+{
+#if defined(UCTERM_HOOK_PRINT_STR)
+  (void)self;
+  UCTERM_HOOK_PRINT_STR(s);
+  return;
+#elif defined(UCTERM_HOOK_PRINT_CHAR)
+  (void)self;
+  while ('\0' != *s)
+  {
+    UCTERM_HOOK_PRINT_CHAR(*(s++));
+  }
+  return;
+#endif
+#if UCTERM_LEGACY_CALLBACKS
+  if (NULL == self->ops)
+  {
+    self->printStr(s);
+    return;
+  }
+#endif
+  if (NULL != self->ops->printStr)
+  {
+    self->ops->printStr(self->user, s);
+    return;
+  }
+  while ('\0' != *s)
+  {
+    self->ops->printChr(self->user, *(s++));
+  }
+}
+
+static inline void _call_print_buf(UcTermState_t *self, const uint8_t *data,
+                                   size_t len)
+{
+#if defined(UCTERM_HOOK_PRINT_BUF)
+  (void)self;
+  UCTERM_HOOK_PRINT_BUF(data, len);
+  return;
+#endif
+#if UCTERM_LEGACY_CALLBACKS
+  if (NULL == self->ops)
+  {
+    self->printBuf(data, len);
+    return;
+  }
+#endif
+  self->ops->printBuf(self->user, data, len);
+}
+
+static inline void _call_exec(UcTermState_t *self, uint8_t argc,
+                              uint8_t **argv)
+{
+#if defined(UCTERM_HOOK_EXEC)
+  (void)self;
+  UCTERM_HOOK_EXEC(argc, argv);
+  return;
+#endif
+#if UCTERM_LEGACY_CALLBACKS
+  if (NULL == self->ops)
+  {
+    self->exec(argc, argv);
+    return;
+  }
+#endif
+  self->ops->exec(self->user, argc, argv);
+}
+
+static inline uint8_t _call_complete(UcTermState_t *self,
+                                     UcTerm_Completion_t *completion)
+{
+#if defined(UCTERM_HOOK_COMPLETE)
+  (void)self;
+  UCTERM_HOOK_COMPLETE(completion);
+  return 1;
+#endif
+  // optional, also with the output and exec hooks
+  if (NULL == self->ops || NULL == self->ops->complete)
+  {
+    return 0;
+  }
+  self->ops->complete(self->user, completion);
+  return 1;
+}
+
+static inline void _flush_frame(UcTermState_t *self)
+{
+#if MAX_FRAME_LEN > 0
+  if (0 < self->frame_len)
+  {
+    _call_print_buf(self, self->frame, self->frame_len);
+    self->frame_len = 0;
+  }
+#else
+  (void)self;
+#endif
+}
+
+static inline size_t _ring_used(const UcTermState_t *self)
+{
+  size_t head = self->ring_head;
+  size_t tail = self->ring_tail;
+  return (head >= tail) ? (head - tail) : (self->ring_size - tail + head);
+}
+
+static inline uint8_t _is_busy(const UcTermState_t *self)
+{
+  size_t used;
+  if (NULL == self->ring)
+  {
+    return 0;
+  }
+  used = _ring_used(self);
+  // an empty ring never blocks the input, even if it's undersized
+  return (0 < used) && ((self->ring_size - 1 - used) < RING_HEADROOM(self));
+}
+
 static inline void _overwrite_terminal_line(UcTermState_t *self)
 {
-  self->printStr(OUT_ERASE_END);
-  self->printStr(&self->buf[self->index]);
-  self->printStr(_get_move_command(self->index));
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index);
+    return;
+  }
+  _print_str(self, OUT_ERASE_END);
+  _print_str(self, &self->buf[self->index]);
+  _move_cursor(self, self->length, self->index);
 }
 
 static inline void _process_home(UcTermState_t *self)
 {
+  _display_move(self, self->index, 0);
   self->index = 0;
-  self->printStr(_get_move_command(self->index));
 }
 
 static inline void _process_end(UcTermState_t *self)
 {
+  _display_move(self, self->index, self->length);
   self->index = self->length;
-  self->printStr(_get_move_command(self->index));
 }
 
 static inline void _process_left_arrow(UcTermState_t *self)
 {
   if (0 < self->index)
   {
+    _display_move(self, self->index, self->index - 1);
     self->index--;
-    self->printStr(OUT_L_ARROW);
   }
-  else
+  else if (!(self->flags & FLAG_DEFERRED))
   {
-    self->printStr(OUT_CHA_2);
+    // put the cursor back if it's been moved onto the prompt
+    uint8_t cmd[MAX_CSI_LEN];
+    _print_str(self, _get_move_command(cmd, 0));
   }
 }
 
@@ -546,8 +1878,8 @@ static inline void _process_right_arrow(UcTermState_t *self)
 {
   if (self->index < self->length)
   {
+    _display_move(self, self->index, self->index + 1);
     self->index++;
-    self->printStr(OUT_R_ARROW);
   }
 }
 
@@ -556,6 +1888,152 @@ static inline void _process_delete(UcTermState_t *self)
   if (self->index < self->length)
   {
     _shift_buf_left(self, self->index);
-    _overwrite_terminal_line(self);
+    _delete_terminal_chars(self, 1);
+  }
+}
+
+static inline uint8_t _can_append(const UcTermState_t *self, uint8_t c)
+{
+  // no ESC-sequence or paste in progress, the cursor is
+  // at the end of the line and there's room for one more char
+  return IS_PRINTABLE(c) && ESC_GROUND == self->esc_state &&
+         !(self->flags & FLAG_PASTE) && self->index == self->length &&
+         (self->buf_size - 2) >= self->index;
+}
+
+static inline void _process_tab(UcTermState_t *self)
+{
+  UcTerm_Completion_t completion = {0};
+  UcTerm_Index_t room = (self->buf_size - 1) - self->length;
+  UcTerm_Index_t start = self->index;
+  uint8_t repeat = self->flags & FLAG_TAB;
+#if MAX_FRAME_LEN == 0
+  uint8_t scratch[MAX_COMPLETION_LEN];
+#endif
+  // the token under the cursor and the count of the ones before
+  while (0 < start && ' ' != self->buf[start - 1])
+  {
+    start--;
+  }
+  for (UcTerm_Index_t i = 0; i < start; i++)
+  {
+    if (' ' != self->buf[i] && (0 == i || ' ' == self->buf[i - 1]))
+    {
+      completion.arg_index++;
+    }
+  }
+  completion.line = self->buf;
+  completion.start = start;
+  completion.length = self->index - start;
+  completion._state = self;
+  self->flags &= ~FLAG_TAB;
+#if MAX_FRAME_LEN > 0
+  // the free part of the frame keeps the common part of the candidates
+  // (unused until the completion is inserted)
+  if (MAX_FRAME_LEN - self->frame_len < MAX_COMPLETION_LEN)
+  {
+    _flush_frame(self);
+  }
+  completion._scratch = &self->frame[self->frame_len];
+#else
+  completion._scratch = scratch;
+#endif
+  completion._room = (MAX_COMPLETION_LEN < room) ? MAX_COMPLETION_LEN : room;
+  if (!_call_complete(self, &completion) || 0 == completion._count)
+  {
+    return;
+  }
+  // a single candidate is followed by a separator
+  if (1 == completion._count && !completion._partial &&
+      completion._common < completion._room && ' ' != self->buf[self->index])
+  {
+    completion._scratch[completion._common++] = ' ';
+  }
+  if (0 < completion._common)
+  {
+    // inserted and displayed at once, like a paste
+    // (copied to the line before anything is printed)
+    _process_paste(self, completion._scratch, completion._common);
+  }
+  else if (repeat)
+  {
+    // nothing to insert on the second Tab, list the candidates
+    // under the line and show the line again
+    _render(self);
+    completion._listing = 1;
+    completion._count = 0;
+    _call_complete(self, &completion);
+    _redraw_line(self);
+  }
+  if (1 < completion._count)
+  {
+    self->flags |= FLAG_TAB;
+  }
+}
+
+static inline void _process_append(UcTermState_t *self, const uint8_t *data,
+                                   UcTerm_Index_t len)
+{
+  UcTerm_Index_t position = self->index;
+  self->flags &= ~FLAG_TAB;
+  memcpy(&self->buf[position], data, len);
+  self->index += len;
+  self->length = self->index;
+  self->buf[self->length] = '\0';
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, position);
+  }
+  else if (1 == len)
+  {
+    _print_char(self, *data);
+  }
+  else
+  {
+    _print_str(self, &self->buf[position]);
+  }
+}
+
+static inline void _process_paste(UcTermState_t *self, const uint8_t *data,
+                                  size_t len)
+{
+  // one char is reserved for termination
+  UcTerm_Index_t room = (self->buf_size - 1) - self->length;
+  UcTerm_Index_t count = 0;
+  UcTerm_Index_t position = self->index;
+  self->flags &= ~FLAG_TAB;
+  // count the printable chars that fit
+  for (size_t i = 0; i < len && count < room; i++)
+  {
+    if (IS_PRINTABLE(data[i]))
+    {
+      count++;
+    }
+  }
+  if (0 == count)
+  {
+    return;
+  }
+  // make room at once (including the terminator)
+  memmove(&self->buf[position + count], &self->buf[position],
+          self->length - position + 1);
+  self->length += count;
+  for (size_t i = 0; position < self->index + count; i++)
+  {
+    if (IS_PRINTABLE(data[i]))
+    {
+      self->buf[position++] = data[i];
+    }
+  }
+  if (self->flags & FLAG_DEFERRED)
+  {
+    _mark_dirty(self, self->index);
+  }
+  else
+  {
+    // the pasted chars and the shifted tail in one go
+    _print_str(self, &self->buf[self->index]);
+    _move_cursor(self, self->length, position);
   }
+  self->index = position;
 }
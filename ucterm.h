@@ -6,6 +6,14 @@ Note: non-ASCII characters are not supported (silently ignored).
 
 The code invokes PrintChar and PrintStr callbacks to output a
 single char or a null-terminated sequence of chars. See the comments below.
+Alternatively, register a PrintBuf callback: the output produced while
+processing one input event (or one buffer passed to UcTerm_IngestBuffer)
+is then collected into an internal frame and passed to PrintBuf
+in as few calls as possible, each one no longer than the frame MTU.
+For non-blocking transmitters (DMA, TX-complete interrupt) assign an
+output ring with UcTerm_SetOutputRing instead: the output is queued there
+and drained by the driver with UcTerm_ReadOutput. Check UcTerm_IsBusy
+before passing the next input char to avoid output loss.
 
 The code invokes Execute callback when user presses Enter key, if
 there is at least one non-whitespace character in the input buffer.
@@ -13,6 +21,8 @@ The number of parsed arguments and their values are passes to the
 function. See the comment below.
 
 The three callbacks MUST be initialized beforehands! No NULL-check inside!
+(PrintChar and PrintStr may be omitted if PrintBuf is registered
+or an output ring is assigned.)
 
 Commands and actions currently supported:
 - enter, backspace, delete keys;
@@ -20,13 +30,20 @@ Commands and actions currently supported:
 - home & end keys as ESC-sequences or hotkeys Ctrl+A/Ctrl+E;
 - Ctrl+K: delete line contents from current position to the end;
 - Ctrl+U: delete line contents from current position to the beginning.
+- bracketed paste (ESC[200~ ... ESC[201~): the pasted text is inserted
+  at once, line breaks and other control chars inside are skipped.
+  The terminal sends these brackets only after receiving ESC[?2004h.
+ESC-sequences are parsed per ECMA-48, so the xterm, VT and SS3 (ESC O)
+variants of the keys above are recognized, modifiers are ignored,
+and other well-formed sequences are skipped silently.
 
 Initialization procedure consists of 3 obligatory steps. You MUST:
 - allocate an UcTerm_HandleTypeDef instance;
 - call the UcTerm_Init, passing the pointer to the allocated memory;
 - register the 3 callbacks: UcTerm_RegisterPrintCharCallback,
                             UcTerm_RegisterPrintStrCallback,
-                            UcTerm_RegisterExecuteCallback.
+                            UcTerm_RegisterExecuteCallback,
+  or bind a shared const UcTerm_Ops table with UcTerm_SetOps.
 
 After initialization, pass all incoming characters to UcTerm_IngestChar.
 
@@ -40,24 +57,52 @@ After initialization, pass all incoming characters to UcTerm_IngestChar.
 #include <stddef.h>
 #include <stdint.h>
 
-// Internal storage size, bytes.
-// Must never be 0!
-// Must match the internal structure size with alignment
-// (i.e. 184 on Win64, 156 on STM32).
-#if defined(_WIN32)
-    #define UCTERM_STORAGE_SIZE 184
-#elif defined(__AVR__)
-    #define UCTERM_STORAGE_SIZE 142
+#include "ucterm_config.h"
+
+/// @brief Input line index type (see UCTERM_INDEX_BITS).
+#if UCTERM_INDEX_BITS > 8
+typedef uint16_t UcTerm_Index_t;
 #else
-    #define UCTERM_STORAGE_SIZE 156
+typedef uint8_t UcTerm_Index_t;
 #endif
 
-#if defined(__AVR__)
-/// @brief UcTerm state storage.
+/// @brief Layout of the internal state, used only to size the storage.
+/// It follows the configuration in ucterm_config.h, so the storage
+/// neither wastes nor overflows memory. Must match UcTermState_t
+/// in ucterm.c field for field, in the same order (checked at compile time).
 typedef struct
+{
+  UcTerm_Index_t _indices[6];
+  uint8_t _flags[5];
+  const void *_pointers[4];
+#if UCTERM_LEGACY_CALLBACKS
+  void (*_callbacks[4])(void);
+#endif
+  size_t _sizes[3];
+  uint32_t _times[2];
+  uint16_t _words[UCTERM_MAX_ESC_PARAMS + 1 + UCTERM_RESUME];
+#if UCTERM_MAX_FRAME_LEN + UCTERM_MAX_STR_LEN > 0
+  uint8_t _bytes[UCTERM_MAX_FRAME_LEN + UCTERM_MAX_STR_LEN];
+#endif
+} UcTerm_StateLayout_t;
+
+// Internal storage size, bytes.
+#define UCTERM_STORAGE_SIZE sizeof(UcTerm_StateLayout_t)
+
+#if UCTERM_SINGLE_INSTANCE
+/// @brief UcTerm handle placeholder, the state is kept inside
+/// ucterm.c (see UCTERM_SINGLE_INSTANCE).
+typedef struct
+{
+  uint8_t _unused;
+} UcTerm_HandleTypeDef;
+#elif defined(__AVR__)
+/// @brief UcTerm state storage.
+typedef union
 {
   // max_align_t excluded for toolchains lacking C11 support 
   uint8_t storage[UCTERM_STORAGE_SIZE];
+  UcTerm_StateLayout_t _layout; // static initialization only
 } UcTerm_HandleTypeDef;
 #else
 /// @brief UcTerm state storage.
@@ -65,13 +110,174 @@ typedef union
 {
   max_align_t _align;
   uint8_t storage[UCTERM_STORAGE_SIZE];
+  UcTerm_StateLayout_t _layout; // static initialization only
 } UcTerm_HandleTypeDef;
 #endif
 
+#if !UCTERM_SINGLE_INSTANCE
+/* Static initialization */
+
+// Internal details of the initializers below
+// (checked against ucterm.c at compile time).
+#define UCTERM_LINE_OFFSET_ \
+  (offsetof(UcTerm_StateLayout_t, _bytes) + UCTERM_MAX_FRAME_LEN)
+#define UCTERM_FLAG_ICH_DCH_ 0x01
+#if defined(UCTERM_HOOK_PRINT_BUF)
+#define UCTERM_FLAG_FRAMED_ 0x10
+#else
+#define UCTERM_FLAG_FRAMED_ 0x00
+#endif
+#define UCTERM_INDEX_MAX_ ((UcTerm_Index_t)~0u)
+#define UCTERM_LINE_CAP_(cap)                                     \
+  ((UcTerm_Index_t)((UCTERM_INDEX_MAX_ - UCTERM_PROMPT_WIDTH < (cap)) \
+                        ? (UCTERM_INDEX_MAX_ - UCTERM_PROMPT_WIDTH)   \
+                        : ((cap) < 2) ? 0 : (cap)))
+
+/// @brief Initializer of a UcTerm_HandleTypeDef with a caller-supplied
+/// input line buffer, the compile-time equivalent of UcTerm_InitWithBuffer
+/// followed by UcTerm_SetOps. The instance is ready at reset with no
+/// UcTerm_Init call. The callbacks table must not have printBuf
+/// (bind such tables with UcTerm_SetOps at runtime).
+/// The settings checksum isn't computed at compile time, so with
+/// UCTERM_RESUME UcTerm_Resume rejects the instance until a setter
+/// (i.e. UcTerm_SetOps) is called; the noinit instances it's meant for
+/// can't be statically initialized anyway.
+/// Not available with UCTERM_SINGLE_INSTANCE.
+/// @param ops      Callbacks table (see UcTerm_Ops).
+/// @param user     Context pointer passed to the callbacks.
+/// @param line     Zero-initialized input line buffer
+///                 (i.e. a static array).
+/// @param cap      Buffer capacity, bytes (at least 2, the instance
+///                 ignores the input otherwise).
+#define UCTERM_STATIC_INITIALIZER_WITH_BUFFER(ops, user, line, cap)       \
+  {                                                                       \
+    ._layout = {                                                          \
+      ._indices = {0, 0, UCTERM_LINE_CAP_(cap), UCTERM_INDEX_MAX_, 0, 0}, \
+      ._flags = {(UCTERM_USE_ICH_DCH ? UCTERM_FLAG_ICH_DCH_ : 0) |        \
+                     UCTERM_FLAG_FRAMED_,                                 \
+                 0, 0, UCTERM_MAX_FRAME_LEN, 0},                          \
+      ._pointers = {(line), NULL, (ops), (user)},                         \
+      ._words = {[UCTERM_MAX_ESC_PARAMS] = UCTERM_ESC_TIMEOUT_MS},        \
+    }                                                                     \
+  }
+
+#if UCTERM_MAX_STR_LEN > 0
+/// @brief Initializer of a UcTerm_HandleTypeDef using the built-in
+/// input line, the compile-time equivalent of UcTerm_Init followed by
+/// UcTerm_SetOps (see UCTERM_STATIC_INITIALIZER_WITH_BUFFER), i.e.:
+/// static UcTerm_HandleTypeDef hterm =
+///     UCTERM_STATIC_INITIALIZER(&ops, &port, hterm);
+/// @param ops      Callbacks table (see UcTerm_Ops).
+/// @param user     Context pointer passed to the callbacks.
+/// @param handle   The variable being initialized.
+#define UCTERM_STATIC_INITIALIZER(ops, user, handle)                \
+  UCTERM_STATIC_INITIALIZER_WITH_BUFFER(                            \
+      ops, user, (uint8_t *)&(handle) + UCTERM_LINE_OFFSET_,        \
+      UCTERM_MAX_STR_LEN)
+#endif
+#endif // !UCTERM_SINGLE_INSTANCE
+
+/// @brief Place a UcTerm_HandleTypeDef in the section not cleared
+/// at startup (see UCTERM_NOINIT_SECTION), so the instance survives
+/// a warm reset (see UcTerm_Resume), i.e.:
+/// UCTERM_NOINIT static UcTerm_HandleTypeDef hterm;
+#if defined(__GNUC__)
+#define UCTERM_NOINIT __attribute__((section(UCTERM_NOINIT_SECTION)))
+#else
+#define UCTERM_NOINIT
+#endif
+
+#if UCTERM_MAX_STR_LEN > 0
 /// @brief Init the internal storage. This must be called
 /// prior to using any functions of the package.
+/// The input line is kept in the internal storage
+/// (UCTERM_MAX_STR_LEN bytes).
 void UcTerm_Init(UcTerm_HandleTypeDef *self);
+#endif
+
+/// @brief Init the internal storage with a caller-supplied input line
+/// buffer. Use it instead of UcTerm_Init to give each instance
+/// the line length it needs; build with UCTERM_MAX_STR_LEN=0
+/// to drop the internal line buffer from every instance.
+/// @param self     UcTerm instance handle.
+/// @param line     Input line buffer, must outlive the instance.
+/// @param cap      Buffer capacity, bytes (at least 2, one byte is
+///                 reserved for termination). Capacities beyond the range
+///                 of the index type (see UCTERM_INDEX_BITS) are cut down.
+/// @return 1 on success, 0 if the line is NULL or holds less than 2 bytes
+///         (after the cut); the instance then ignores the input.
+uint8_t UcTerm_InitWithBuffer(UcTerm_HandleTypeDef *self, uint8_t *line,
+                              size_t cap);
+
+/// @brief Tab completion request passed to the Complete callback.
+/// The callback reports the candidates (whole tokens) with
+/// UcTerm_CompletionAdd; the ones not starting with the typed part
+/// are skipped, so it may report more than the matching ones.
+/// The callback must not print anything.
+typedef struct
+{
+  const uint8_t *line;     ///< input line (null-terminated)
+  UcTerm_Index_t start;    ///< index of the token under the cursor
+  UcTerm_Index_t length;   ///< length of the typed part of the token
+  uint8_t arg_index;       ///< index of the token (0 - command name)
+  /* internal */
+  void *_state;
+  uint16_t _count;
+  UcTerm_Index_t _common;
+  UcTerm_Index_t _room;
+  uint8_t *_scratch;
+  uint8_t _partial;
+  uint8_t _listing;
+} UcTerm_Completion_t;
+
+/// @brief Callbacks table, shared by any number of instances
+/// (declare it const to keep it in flash on most targets).
+/// Every callback receives the context pointer of the instance
+/// (see UcTerm_SetOps), so one set of driver functions serves
+/// all the instances. The rules of the corresponding
+/// UcTerm_Register*Callback functions apply.
+typedef struct
+{
+  /// Output a single char (mandatory unless the output goes
+  /// through printBuf or an output ring).
+  void (*printChr)(void *user, uint8_t c);
+  /// Output a null-terminated string (optional, NULL to output
+  /// the string with printChr char by char).
+  void (*printStr)(void *user, const uint8_t *s);
+  /// Output a sequence of bytes collected into frames
+  /// (optional, NULL to use printChr and printStr).
+  void (*printBuf)(void *user, const uint8_t *data, size_t len);
+  /// Execute the parsed command (mandatory).
+  void (*exec)(void *user, uint8_t argc, uint8_t **argv);
+  /// Report the completion candidates of the token under the cursor
+  /// on Tab (optional, NULL to ignore Tab).
+  void (*complete)(void *user, UcTerm_Completion_t *completion);
+} UcTerm_Ops;
+
+/// @brief Report a completion candidate from the Complete callback.
+/// The common part of the candidates is inserted at the cursor
+/// (up to UCTERM_MAX_COMPLETION_LEN chars per Tab, followed by a space
+/// if there's only one candidate and it's complete), and the second Tab
+/// in a row lists them under the line (up to UCTERM_MAX_COMPLETIONS).
+/// The candidates are used on the spot, so they may be generated
+/// into a temporary buffer.
+/// @param completion   Request passed to the callback.
+/// @param candidate    Whole token (null-terminated).
+/// @return 1 to go on, 0 if no more candidates are needed.
+uint8_t UcTerm_CompletionAdd(UcTerm_Completion_t *completion,
+                             const uint8_t *candidate);
+
+/// @brief Bind the instance to a shared callbacks table
+/// instead of the callbacks registered one by one.
+/// Pass NULL to return to the UcTerm_Register*Callback ones
+/// (if UCTERM_LEGACY_CALLBACKS is enabled).
+/// @param self     UcTerm instance handle.
+/// @param ops      Callbacks table, must outlive the instance.
+/// @param user     Context pointer passed to the callbacks.
+void UcTerm_SetOps(UcTerm_HandleTypeDef *self, const UcTerm_Ops *ops,
+                   void *user);
 
+#if UCTERM_LEGACY_CALLBACKS
 /// @brief Register a callback function to output a single uint8_t.
 /// The function will be called when the UcTerm instance
 /// needs to output a uint8_t.
@@ -90,6 +296,112 @@ void UcTerm_RegisterPrintCharCallback(UcTerm_HandleTypeDef *self,
 void UcTerm_RegisterPrintStrCallback(UcTerm_HandleTypeDef *self,
                                      void (*printStr)(const uint8_t *));
 
+/// @brief Register a callback function to output a sequence of bytes
+/// of the specified length (no null-termination).
+/// Once registered, all the output of a single input event is collected
+/// into the internal frame and passed to this callback at once instead
+/// of the PrintChar and PrintStr callbacks. Frames longer than the MTU
+/// (see UcTerm_SetFrameMtu) are split into several calls.
+/// The memory location pointed to by the argument of the callback fn
+/// isn't guaranteed to remain intact after the callback fn returns.
+/// Pass NULL to return to the PrintChar/PrintStr output.
+/// @param self     UcTerm instance handle.
+/// @param printBuf Callback function (const uint8_t *data, size_t len).
+void UcTerm_RegisterPrintBufCallback(UcTerm_HandleTypeDef *self,
+                                     void (*printBuf)(const uint8_t *,
+                                                      size_t));
+#endif
+
+/// @brief Set the maximum number of bytes passed to the PrintBuf
+/// callback at once (i.e. 64 for a USB full-speed endpoint).
+/// Values of 0 or exceeding the internal frame capacity (64 bytes)
+/// select the frame capacity, which is also the default.
+/// @param self     UcTerm instance handle.
+/// @param mtu      Maximum output chunk size, bytes.
+void UcTerm_SetFrameMtu(UcTerm_HandleTypeDef *self, size_t mtu);
+
+/// @brief Assign a caller-allocated ring buffer for the output.
+/// Once assigned, the output isn't pushed to the callbacks but queued
+/// in the ring to be pulled with UcTerm_ReadOutput. The ring should hold
+/// at least a full line redraw (input line length + 16 bytes), otherwise
+/// the output may be lost. The completion listing is cut short to fit.
+/// Pass NULL to return to the callback output.
+/// @param self     UcTerm instance handle.
+/// @param ring     Ring buffer memory, must outlive the instance.
+/// @param size     Ring buffer size, bytes (one byte is kept free).
+void UcTerm_SetOutputRing(UcTerm_HandleTypeDef *self, uint8_t *ring,
+                          size_t size);
+
+/// @brief Pull the queued output from the output ring.
+/// Safe to call from the TX interrupt while the input is processed
+/// elsewhere as long as the platform reads and writes size_t atomically
+/// (on 8-bit targets, guard the call or the input processing
+/// with a critical section).
+/// @param self     UcTerm instance handle.
+/// @param buf      Destination buffer.
+/// @param max      Destination buffer capacity, bytes.
+/// @return         Count of bytes copied to buf.
+size_t UcTerm_ReadOutput(UcTerm_HandleTypeDef *self, uint8_t *buf,
+                         size_t max);
+
+/// @brief Check if the output ring lacks space for the output of the next
+/// input char. Stop passing the input while busy and resume after
+/// draining the ring with UcTerm_ReadOutput.
+/// @param self     UcTerm instance handle.
+/// @return         1 if busy, 0 if the next char may be processed
+///                 (always 0 without the output ring).
+uint8_t UcTerm_IsBusy(UcTerm_HandleTypeDef *self);
+
+/// @brief Select how mid-line insertions and deletions are displayed.
+/// By default, the line tail is redrawn, so the output grows with
+/// the line length. With the ICH/DCH mode enabled, a single VT ESC-sequence
+/// (ESC[@ to insert, ESC[P to delete) is sent instead regardless of
+/// the line length. Don't enable it for terminals lacking these sequences.
+/// Build with UCTERM_USE_ICH_DCH=1 to make it the default.
+/// @param self     UcTerm instance handle.
+/// @param enable   1 to use ICH/DCH, 0 to redraw the line tail.
+void UcTerm_SetInsertDeleteMode(UcTerm_HandleTypeDef *self, uint8_t enable);
+
+/// @brief Enable or disable the deferred rendering.
+/// In the deferred mode, the input line edits aren't displayed
+/// immediately: the changed part of the line and the cursor position
+/// are tracked and sent at once on UcTerm_Flush or when the output ring
+/// is found empty by UcTerm_ReadOutput. The intermediate states of
+/// the line under bursty input (paste, press-and-hold) are never sent.
+/// The pending changes are displayed before any other output
+/// (i.e. on Enter) and when the mode is disabled.
+/// Note that UcTerm_ReadOutput renders the pending changes itself,
+/// so it must not preempt the input processing in this mode.
+/// @param self     UcTerm instance handle.
+/// @param enable   1 to postpone the rendering, 0 to render immediately.
+void UcTerm_SetDeferredRendering(UcTerm_HandleTypeDef *self, uint8_t enable);
+
+/// @brief Output the pending changes of the input line
+/// (in the deferred mode) and the pending output frame (in PrintBuf mode).
+/// @param self     UcTerm instance handle.
+void UcTerm_Flush(UcTerm_HandleTypeDef *self);
+
+/// @brief Set the time after which an incomplete ESC-sequence is dropped
+/// (i.e. a lone ESC key press or a sequence cut off on a noisy line),
+/// so that the following input isn't taken for its continuation.
+/// A bracketed paste missing its end (ESC[201~) ends after the same
+/// time without input. Requires UcTerm_Tick to be called. The default is 50 ms
+/// (UCTERM_ESC_TIMEOUT_MS), 0 disables the timeout.
+/// @param self         UcTerm instance handle.
+/// @param timeout_ms   Timeout since the last byte of the sequence, ms.
+void UcTerm_SetEscTimeout(UcTerm_HandleTypeDef *self, uint16_t timeout_ms);
+
+/// @brief Advance the time base of the engine. Call it periodically
+/// (i.e. from a 1-10 ms timer or the main loop) outside the input
+/// processing. An incomplete ESC-sequence is dropped (and a paste missing
+/// its end is ended) after the timeout (see UcTerm_SetEscTimeout),
+/// and if no input has been received since the previous tick,
+/// the pending output is sent as by UcTerm_Flush.
+/// @param self     UcTerm instance handle.
+/// @param now_ms   Current time, ms (wraps around).
+void UcTerm_Tick(UcTerm_HandleTypeDef *self, uint32_t now_ms);
+
+#if UCTERM_LEGACY_CALLBACKS
 /// @brief Register a callback function to execute the parsed commands.
 /// The function will receive an array of pointers to null-terminated
 /// strings and the total count of these pointers.
@@ -100,12 +412,41 @@ void UcTerm_RegisterPrintStrCallback(UcTerm_HandleTypeDef *self,
 /// @param execute  Callback function (uint8_t argc, uint8_t *argv[]).
 void UcTerm_RegisterExecuteCallback(UcTerm_HandleTypeDef *self,
                                     void (*execute)(uint8_t, uint8_t **));
+#endif
 
 /// @brief Output a standard command prompt.
 void UcTerm_ShowPrompt(UcTerm_HandleTypeDef *self);
 
+#if UCTERM_RESUME
+/// @brief Take over an instance which survived a reset in a section
+/// not cleared at startup (see UCTERM_NOINIT): check its settings
+/// and input line, drop the pending output and the ESC-sequence
+/// in progress and show the prompt with the line again.
+/// Only valid within the same firmware image, as the callbacks
+/// and buffers addresses are kept.
+/// @param self     UcTerm instance handle.
+/// @return 1 if the instance is resumed, 0 if its storage is invalid
+/// (i.e. after a power-on) and it must be initialized.
+uint8_t UcTerm_Resume(UcTerm_HandleTypeDef *self);
+#endif
+
 /// @brief Process a uint8_t from the input stream.
 void UcTerm_IngestChar(UcTerm_HandleTypeDef *self, uint8_t c);
 
+/// @brief Process a chunk of bytes from the input stream
+/// (i.e. a DMA buffer filled on the UART idle line event).
+/// The resulting line state and screen are the same as after passing
+/// every byte to UcTerm_IngestChar in order, but the output bytes may
+/// differ: the runs of printable chars (typed or pasted) are echoed
+/// at once, so there are fewer intermediate redraws.
+/// With an output ring, the processing stops once the ring is busy
+/// (see UcTerm_IsBusy): pass the rest again after draining it.
+/// @param self     UcTerm instance handle.
+/// @param data     Pointer to the received bytes.
+/// @param len      Number of bytes to process.
+/// @return         Count of bytes processed (len unless the ring is busy).
+size_t UcTerm_IngestBuffer(UcTerm_HandleTypeDef *self, const uint8_t *data,
+                           size_t len);
+
 #endif // UCTERM_H_
 
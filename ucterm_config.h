@@ -0,0 +1,190 @@
+/*
+UcTerm compile-time configuration.
+
+Every setting below may be overridden with a compiler option
+(i.e. -DUCTERM_MAX_STR_LEN=40) or in a user configuration header
+included first when UCTERM_CONFIG_FILE is defined
+(i.e. -DUCTERM_CONFIG_FILE=\"my_ucterm_config.h\").
+The settings apply to all the UcTerm instances of the build, and the
+internal storage size (UCTERM_STORAGE_SIZE) is derived from them.
+*/
+
+#ifndef UCTERM_CONFIG_H_
+#define UCTERM_CONFIG_H_
+
+#if defined(UCTERM_CONFIG_FILE)
+#include UCTERM_CONFIG_FILE
+#endif
+
+/* Storage */
+
+// Maximum input line length
+// (one byte is always reserved for termination).
+// This is the size of the line buffer built into the state storage
+// (see UcTerm_Init). Set to 0 to drop it and supply the line buffers
+// with UcTerm_InitWithBuffer.
+#ifndef UCTERM_MAX_STR_LEN
+#define UCTERM_MAX_STR_LEN 120
+#endif
+
+// Maximum number of cli arguments
+// (including the command itself).
+#ifndef UCTERM_MAX_ARG_COUNT
+#define UCTERM_MAX_ARG_COUNT 4
+#endif
+
+// Maximum count of numeric ESC-sequence parameters
+// (the rest are parsed and discarded).
+#ifndef UCTERM_MAX_ESC_PARAMS
+#define UCTERM_MAX_ESC_PARAMS 2
+#endif
+
+// Output frame capacity - the largest chunk
+// passed to the PrintBuf callback at once. 0 takes the frame out
+// of every instance (the PrintBuf callback then gets one char at a time).
+#ifndef UCTERM_MAX_FRAME_LEN
+#define UCTERM_MAX_FRAME_LEN 64
+#endif
+
+// Width of the input line indices, 8 or 16 bits.
+// The 8-bit indices are the fastest on 8-bit targets
+// but limit the line length to 255 chars.
+#ifndef UCTERM_INDEX_BITS
+#define UCTERM_INDEX_BITS 8
+#endif
+
+/* Prompt */
+
+// Command prompt printed at the beginning of each input line
+// (a string literal).
+#ifndef UCTERM_PROMPT
+#define UCTERM_PROMPT ">"
+#endif
+
+// How many visible characters does the prompt contain.
+#ifndef UCTERM_PROMPT_WIDTH
+#define UCTERM_PROMPT_WIDTH 1
+#endif
+
+/* Behavior */
+
+// Set to 1 to use ICH/DCH for mid-line edits by default
+// (switchable at runtime with UcTerm_SetInsertDeleteMode).
+#ifndef UCTERM_USE_ICH_DCH
+#define UCTERM_USE_ICH_DCH 0
+#endif
+
+// Set to 0 to disable the fast path for the printable chars
+// appended at the end of the line (i.e. to benchmark it).
+#ifndef UCTERM_FAST_APPEND
+#define UCTERM_FAST_APPEND 1
+#endif
+
+// Maximum number of the completion candidates listed
+// on the second Tab in a row (the rest are cut off with "...").
+#ifndef UCTERM_MAX_COMPLETIONS
+#define UCTERM_MAX_COMPLETIONS 64
+#endif
+
+// Maximum number of chars inserted by a single Tab (the rest of a longer
+// word takes another Tab). The completion is collected in the free part
+// of the output frame, so it can't exceed UCTERM_MAX_FRAME_LEN
+// (the default is 32 or the frame size, whichever is less);
+// without the frame it's collected on the stack.
+#ifndef UCTERM_MAX_COMPLETION_LEN
+#define UCTERM_MAX_COMPLETION_LEN \
+  ((0 < UCTERM_MAX_FRAME_LEN && UCTERM_MAX_FRAME_LEN < 32) \
+       ? UCTERM_MAX_FRAME_LEN                             \
+       : 32)
+#endif
+
+// Default time after which an incomplete ESC-sequence is dropped
+// (see UcTerm_SetEscTimeout), 0 disables the timeout.
+#ifndef UCTERM_ESC_TIMEOUT_MS
+#define UCTERM_ESC_TIMEOUT_MS 50
+#endif
+
+// Set to 0 to drop the UcTerm_Register*Callback functions and their
+// per-instance pointers: the callbacks are then only set with
+// UcTerm_SetOps, and each instance carries the table and context
+// pointers only. The legacy callbacks cost 4 code pointers per instance
+// (8 bytes on AVR, 16 on 32-bit targets, 32 on 64-bit hosts), also
+// when the table is used.
+#ifndef UCTERM_LEGACY_CALLBACKS
+#define UCTERM_LEGACY_CALLBACKS 1
+#endif
+
+// Set to 1 to keep a checksum of the instance settings and enable
+// UcTerm_Resume, which takes over an instance kept through a warm reset
+// in a section not cleared at startup (see UCTERM_NOINIT).
+#ifndef UCTERM_RESUME
+#define UCTERM_RESUME 0
+#endif
+
+// Linker section of the instances marked UCTERM_NOINIT (a string literal).
+// The linker script must provide it and the startup code must not clear it.
+#ifndef UCTERM_NOINIT_SECTION
+#define UCTERM_NOINIT_SECTION ".noinit"
+#endif
+
+/* Single instance */
+
+// Set to 1 if the application has only one terminal: the state is then
+// a static variable of ucterm.c at a fixed address, the handle passed
+// to the functions is ignored (UcTerm_HandleTypeDef shrinks to a 1-byte
+// placeholder), so the compiler may use absolute addressing. Whether
+// that saves code depends on the target (see README.md).
+#ifndef UCTERM_SINGLE_INSTANCE
+#define UCTERM_SINGLE_INSTANCE 0
+#endif
+
+// Compile-time output, exec and completion hooks. Define any of them (i.e. in the
+// UCTERM_CONFIG_FILE header, along with the prototypes they use)
+// to replace the corresponding callback of all the instances with
+// a direct call the compiler may inline:
+//   #define UCTERM_HOOK_PRINT_CHAR(c)          uart_putc(c)
+//   #define UCTERM_HOOK_PRINT_STR(s)           uart_puts(s)
+//   #define UCTERM_HOOK_PRINT_BUF(data, len)   uart_write(data, len)
+//   #define UCTERM_HOOK_EXEC(argc, argv)       cli_execute(argc, argv)
+//   #define UCTERM_HOOK_COMPLETE(completion)   cli_complete(completion)
+// Without UCTERM_HOOK_PRINT_STR the strings go through
+// UCTERM_HOOK_PRINT_CHAR. UCTERM_HOOK_PRINT_BUF selects the framed
+// output for all the instances.
+
+/* Sanity checks */
+
+#if UCTERM_INDEX_BITS != 8 && UCTERM_INDEX_BITS != 16
+#error "UCTERM_INDEX_BITS must be 8 or 16"
+#endif
+
+#if (UCTERM_MAX_STR_LEN != 0 && UCTERM_MAX_STR_LEN < 2) || \
+    UCTERM_MAX_STR_LEN + UCTERM_PROMPT_WIDTH > (1L << UCTERM_INDEX_BITS) - 1
+#error "UCTERM_MAX_STR_LEN doesn't fit the index type (see UCTERM_INDEX_BITS)"
+#endif
+
+#if UCTERM_PROMPT_WIDTH + 2 > (1L << UCTERM_INDEX_BITS) - 1
+#error "UCTERM_PROMPT_WIDTH leaves no room for the line (see UCTERM_INDEX_BITS)"
+#endif
+
+#if UCTERM_MAX_ARG_COUNT < 1 || UCTERM_MAX_ARG_COUNT > 255
+#error "UCTERM_MAX_ARG_COUNT must be in the range 1..255"
+#endif
+
+#if UCTERM_MAX_ESC_PARAMS < 1 || UCTERM_MAX_ESC_PARAMS > 255
+#error "UCTERM_MAX_ESC_PARAMS must be in the range 1..255"
+#endif
+
+#if UCTERM_MAX_FRAME_LEN < 0 || UCTERM_MAX_FRAME_LEN > 255
+#error "UCTERM_MAX_FRAME_LEN must be in the range 0..255"
+#endif
+
+#if UCTERM_MAX_FRAME_LEN > 0 && (UCTERM_MAX_COMPLETION_LEN < 1 || \
+    UCTERM_MAX_COMPLETION_LEN > UCTERM_MAX_FRAME_LEN)
+#error "UCTERM_MAX_COMPLETION_LEN must be in the range 1..UCTERM_MAX_FRAME_LEN"
+#endif
+
+#if UCTERM_MAX_COMPLETION_LEN < 1 || UCTERM_MAX_COMPLETION_LEN > 255
+#error "UCTERM_MAX_COMPLETION_LEN must be in the range 1..255"
+#endif
+
+#endif // UCTERM_CONFIG_H_